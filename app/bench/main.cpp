@@ -0,0 +1,373 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+#include <cstmlib/Log.h>
+#include "glm/gtc/constants.hpp"
+
+#include "Chunk.h"
+#include "Entity.h"
+#include "Raycast.h"
+#include "WorldSaver.h"
+
+// Headless streaming benchmark, runs the chunk pipeline along scripted flight paths without a window or GL context.
+// Usage: VoxelGame_bench [output.json] [renderDistance] [--no-prefetch] [--no-lod] [--no-mesh-cache]
+
+constexpr uint32_t BENCH_SEED = 1337;
+constexpr double FRAME_TIME = 1.0 / 60.0;
+constexpr uint32_t FRAMES_PER_PATH = 600;
+constexpr float FLIGHT_HEIGHT = WorldGenerationData::SEA_LEVEL + 40.0f;
+// surface columns edited around where each path ends, every one gets a lamp and a block placed and taken away
+constexpr int32_t RELIGHT_COLUMNS = 32;
+
+struct FlightPath
+{
+    const char* name;
+    std::function<glm::vec3(double seconds)> position;
+};
+
+const FlightPath FLIGHT_PATHS[] = {
+    {"straight", [](const double t) { return glm::vec3(t * 60.0, FLIGHT_HEIGHT, 0.0f); }},
+    {"spiral", [](const double t)
+    {
+        const double radius = 32.0 + 24.0 * t;
+        return glm::vec3(radius * glm::cos(t), FLIGHT_HEIGHT, radius * glm::sin(t));
+    }},
+    {"dive", [](const double t) { return glm::vec3(0.0f, glm::max(WorldGenerationData::MAX_HEIGHT - 25.0 * t, 1.0), 0.0f); }},
+};
+
+enum STAGE { UNLOAD, LOAD, MESH, RAYCAST, PHYSICS, FRAME, STAGE_COUNT };
+constexpr const char* STAGE_NAMES[] = {"unload", "load", "mesh", "raycast", "physics", "frame"};
+
+struct PathResult
+{
+    const char* name;
+    double seconds = 0.0;
+    uint64_t chunksGenerated = 0, facesMeshed = 0;
+    // jobs cancelled before they started and jobs whose result was thrown away
+    uint64_t droppedJobs = 0, wastedJobs = 0;
+    double wastedJobMs = 0.0;
+    // accepted mesh results and the chunks they went to
+    uint64_t meshesBuilt = 0, chunksWithMesh = 0;
+    uint64_t meshCacheHits = 0, meshCacheMisses = 0;
+    double meshCacheSavedMs = 0.0;
+    // faces meshed and chunks in render at the end of the path per level of detail, the faces are the instances drawn
+    std::array<uint64_t, ChunkManager::LOD_COUNT> facesPerLod{}, chunksPerLod{};
+    std::array<std::vector<double>, STAGE_COUNT> stageMs;
+    std::array<MemoryUsage, MEMORY_CATEGORY_COUNT> memory;
+    // distance in blocks to the closest chunk ahead that has no mesh yet, larger means less pop-in
+    std::vector<double> missingAheadDistance;
+    // per scripted edit that changed light
+    std::vector<double> relightMs, relitVoxels;
+};
+
+// Closest chunk within the render distance and a 60 degree cone around dir that is not meshed yet
+static double nearestMissingAhead(ChunkManager& chunkManager, const glm::vec3& camPos, const glm::vec3& dir)
+{
+    const glm::ivec3 center = worldPosToChunkPos(camPos);
+    const auto radius = int32_t(chunkManager.renderDistance);
+    double nearest = double(radius * Chunk::CHUNK_SIZE);
+
+    for (int32_t x = center.x - radius; x <= center.x + radius; x++)
+    {
+        for (int32_t y = 0; y < int32_t(WorldGenerationData::WORLD_HEIGHT); y++)
+        {
+            for (int32_t z = center.z - radius; z <= center.z + radius; z++)
+            {
+                const glm::vec3 toChunk = (glm::vec3(x, y, z) + 0.5f) * float(Chunk::CHUNK_SIZE) - camPos;
+                const float distance = glm::length(toChunk);
+                if (distance > 0.0f && glm::dot(toChunk / distance, dir) < 0.5f)
+                    continue;
+
+                const Chunk* chunk = chunkManager.getChunk({x, y, z});
+                if (!chunk || !chunk->hasMesh)
+                    nearest = glm::min(nearest, double(distance));
+            }
+        }
+    }
+
+    return nearest;
+}
+
+static double percentile(std::vector<double>& values, const double p)
+{
+    if (values.empty())
+        return 0.0;
+
+    std::sort(values.begin(), values.end());
+    return values[size_t(p * double(values.size() - 1) + 0.5)];
+}
+
+static double peakRssMB()
+{
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return double(usage.ru_maxrss) / 1024.0;
+}
+
+// the world file with the files SQLite keeps next to it in WAL mode
+static void removeSaveFile(const std::string& path)
+{
+    for (const char* suffix : {"", "-wal", "-shm"})
+        std::filesystem::remove(path + suffix);
+}
+
+template<typename F>
+static void timeStage(PathResult& result, const STAGE stage, F&& func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    const std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+    result.stageMs[stage].push_back(ms.count());
+}
+
+static PathResult runPath(const FlightPath& path, const GameConfig& config, const bool prefetch)
+{
+    PathResult result;
+    result.name = path.name;
+
+    // every path starts from the unmodified world
+    removeSaveFile(config.saveGamePath);
+    ChunkManager chunkManager(config);
+    SQLite::Database db = initDB(config.saveGamePath);
+    WorldSaver saver(config.saveGamePath, config.compactionThreshold, config.worldSeed);
+
+    // a few falling boxes around the camera stand in for entities
+    std::vector<PhysicsObject> entities;
+    for (int32_t i = 0; i < 8; i++)
+        entities.push_back(PhysicsObject{BoundingBox{glm::vec3{i * 4.0f, FLIGHT_HEIGHT, 8.0f}, glm::vec3{1.0f, 2.0f, 1.0f}}, glm::vec3(0.0f)});
+
+    glm::vec3 flightDir{1.0f, 0.0f, 0.0f};
+    const auto pathStart = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < FRAMES_PER_PATH; frame++)
+    {
+        const auto frameStart = std::chrono::steady_clock::now();
+        const double t = frame * FRAME_TIME;
+        const glm::vec3 camPos = path.position(t);
+        const glm::ivec3 chunkPos = worldPosToChunkPos(camPos);
+
+        const glm::vec3 velocity = (path.position(t + FRAME_TIME) - camPos) / float(FRAME_TIME);
+        if (glm::length(velocity) > 0.0f)
+            flightDir = glm::normalize(velocity);
+        if (prefetch)
+            chunkManager.focus = {camPos, velocity, flightDir};
+        else
+            chunkManager.focus = {camPos, glm::vec3(0.0f), glm::vec3(0.0f)};
+
+        timeStage(result, UNLOAD, [&] { chunkManager.unloadChunks(chunkPos, saver, config.maxUnloadsPerFrame); });
+
+        const size_t chunksBefore = chunkManager.chunks.size();
+        timeStage(result, LOAD, [&] { chunkManager.loadChunks(chunkPos, db, saver, config.maxLoadsPerFrame); });
+        result.chunksGenerated += chunkManager.chunks.size() - chunksBefore;
+
+        timeStage(result, MESH, [&]
+        {
+            chunkManager.meshChunks(chunkPos, config.maxBakesPerFrame);
+
+            // stands in for the upload, the mesh data is what a GPU buffer would receive
+            for (const auto& pos : chunkManager.uploadQueue)
+            {
+                Chunk* chunk = chunkManager.getChunk(pos);
+                if (!chunk || !chunk->isMeshDataReady || chunk->isMeshBaked)
+                    continue;
+
+                result.facesMeshed += chunk->meshDataOpaque.size() + chunk->meshDataTranslucent.size();
+                result.facesPerLod[chunk->lod] += chunk->meshDataOpaque.size() + chunk->meshDataTranslucent.size();
+                chunkManager.commitMesh(*chunk, chunk->faceCounts, std::move(chunk->meshDataTranslucent));
+            }
+            chunkManager.uploadQueue.clear();
+        });
+
+        timeStage(result, RAYCAST, [&]
+        {
+            for (int32_t i = 0; i < 16; i++)
+            {
+                const float angle = float(i) / 16.0f * glm::two_pi<float>();
+                const glm::vec3 dir = glm::normalize(glm::vec3{glm::cos(angle), -0.5f, glm::sin(angle)});
+                raycast(camPos, dir, config.reachDistance, chunkManager);
+            }
+        });
+
+        timeStage(result, PHYSICS, [&]
+        {
+            for (auto& entity : entities)
+            {
+                entity.box.pos.x = camPos.x + (&entity - entities.data()) * 4.0f;
+                entity.box.pos.z = camPos.z + 8.0f;
+                applyGravity(entity, (float) FRAME_TIME);
+                applyVelocityAndHandleCollisions(chunkManager, entity);
+            }
+        });
+
+        const std::chrono::duration<double, std::milli> frameMs = std::chrono::steady_clock::now() - frameStart;
+        result.stageMs[FRAME].push_back(frameMs.count());
+        result.missingAheadDistance.push_back(nearestMissingAhead(chunkManager, camPos, flightDir));
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pathStart).count();
+
+    const glm::vec3 endPos = path.position(FRAMES_PER_PATH * FRAME_TIME);
+    for (int32_t i = 0; i < RELIGHT_COLUMNS; i++)
+    {
+        const glm::ivec2 column = glm::ivec2(int32_t(endPos.x), int32_t(endPos.z)) + glm::ivec2{i % 8, i / 8} * 3 - 12;
+        const int32_t surfaceY = glm::max(int32_t(chunkManager.worldGenData.getHeightAt(column)), int32_t(WorldGenerationData::SEA_LEVEL) + 1);
+        const glm::ivec3 worldPos{column.x, surfaceY, column.y};
+        Chunk* chunk = chunkManager.getChunk(worldPosToChunkPos(worldPos));
+        if (!chunk || !chunk->isLit)
+            continue;
+
+        const glm::ivec3 positionInChunk = worldPosToChunkBlockPos(worldPos);
+        const BLOCK_TYPE original = chunk->getBlockUnsafe(positionInChunk);
+        for (const BLOCK_TYPE block : {BLOCK_TYPE::LAMP, original, BLOCK_TYPE::STONE, original})
+        {
+            const uint64_t relights = chunkManager.relights;
+            chunkManager.setBlock(*chunk, positionInChunk, block);
+            if (chunkManager.relights == relights)
+                continue;
+            result.relightMs.push_back(chunkManager.lastRelightMs);
+            result.relitVoxels.push_back(double(chunkManager.lastRelitVoxels));
+        }
+    }
+    result.droppedJobs = chunkManager.threadPool.droppedJobs.load();
+    result.wastedJobs = chunkManager.wastedJobs;
+    result.wastedJobMs = chunkManager.wastedJobMs;
+    result.meshesBuilt = chunkManager.meshesBuilt;
+    result.chunksWithMesh = chunkManager.chunksWithMesh;
+    result.meshCacheHits = chunkManager.meshCacheHits;
+    result.meshCacheMisses = chunkManager.meshCacheMisses;
+    result.meshCacheSavedMs = chunkManager.meshCacheSavedMs;
+    for (const auto& [_, chunk] : chunkManager.chunks)
+        if (chunk.inRender && chunk.hasMesh)
+            result.chunksPerLod[chunk.meshLod]++;
+    for (uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+        result.memory[i] = getMemoryUsage(MEMORY_CATEGORY(i));
+    return result;
+}
+
+static void writeJson(std::ostream& out, const GameConfig& config, const bool prefetch, std::vector<PathResult>& results)
+{
+    out << "{\n";
+    out << "  \"prefetch\": " << (prefetch ? "true" : "false") << ",\n";
+    out << "  \"seed\": " << config.worldSeed << ",\n";
+    out << "  \"renderDistance\": " << config.renderDistance << ",\n";
+    out << "  \"loadDistance\": " << config.loadDistance << ",\n";
+    out << "  \"lodDistances\": [" << config.lod1Distance << ", " << config.lod2Distance << "],\n";
+    out << "  \"meshCacheMB\": " << config.meshCacheMB << ",\n";
+    out << "  \"threads\": " << config.threadCount << ",\n";
+    out << "  \"framesPerPath\": " << FRAMES_PER_PATH << ",\n";
+    out << "  \"paths\": [\n";
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        PathResult& result = results[i];
+        out << "    {\n";
+        out << "      \"name\": \"" << result.name << "\",\n";
+        out << "      \"seconds\": " << result.seconds << ",\n";
+        out << "      \"chunksGenerated\": " << result.chunksGenerated << ",\n";
+        out << "      \"chunksPerSecond\": " << double(result.chunksGenerated) / result.seconds << ",\n";
+        out << "      \"facesMeshed\": " << result.facesMeshed << ",\n";
+        out << "      \"facesPerSecond\": " << double(result.facesMeshed) / result.seconds << ",\n";
+        out << "      \"jobs\": {\"dropped\": " << result.droppedJobs << ", \"wasted\": " << result.wastedJobs
+            << ", \"wastedMs\": " << result.wastedJobMs << "},\n";
+        out << "      \"meshesPerChunk\": " << (result.chunksWithMesh > 0 ? double(result.meshesBuilt) / double(result.chunksWithMesh) : 0.0) << ",\n";
+        out << "      \"meshCache\": {\"hits\": " << result.meshCacheHits << ", \"misses\": " << result.meshCacheMisses
+            << ", \"savedMs\": " << result.meshCacheSavedMs << "},\n";
+        out << "      \"lod\": [";
+        for (uint32_t lod = 0; lod < ChunkManager::LOD_COUNT; lod++)
+        {
+            out << "{\"chunks\": " << result.chunksPerLod[lod] << ", \"faces\": " << result.facesPerLod[lod] << "}"
+                << (lod + 1 < ChunkManager::LOD_COUNT ? ", " : "");
+        }
+        out << "],\n";
+        out << "      \"relight\": {\"edits\": " << result.relightMs.size() << ", \"p50\": " << percentile(result.relightMs, 0.5)
+            << ", \"p99\": " << percentile(result.relightMs, 0.99) << ", \"voxelsP50\": " << percentile(result.relitVoxels, 0.5)
+            << ", \"voxelsP99\": " << percentile(result.relitVoxels, 0.99) << "},\n";
+        out << "      \"missingAheadBlocks\": {\"p5\": " << percentile(result.missingAheadDistance, 0.05)
+            << ", \"p50\": " << percentile(result.missingAheadDistance, 0.5) << "},\n";
+        out << "      \"stages\": {\n";
+        for (uint32_t stage = 0; stage < STAGE_COUNT; stage++)
+        {
+            auto& values = result.stageMs[stage];
+            out << "        \"" << STAGE_NAMES[stage] << "\": {\"p50\": " << percentile(values, 0.5)
+                << ", \"p99\": " << percentile(values, 0.99) << "}" << (stage + 1 < STAGE_COUNT ? "," : "") << "\n";
+        }
+        out << "      },\n";
+        out << "      \"memory\": {\n";
+        for (uint32_t category = 0; category < MEMORY_CATEGORY_COUNT; category++)
+        {
+            out << "        \"" << MEMORY_CATEGORY_NAMES[category] << "\": {\"bytes\": " << result.memory[category].bytes
+                << ", \"objects\": " << result.memory[category].objects << "}" << (category + 1 < MEMORY_CATEGORY_COUNT ? "," : "") << "\n";
+        }
+        out << "      }\n";
+        out << "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    out << "  ],\n";
+    out << "  \"peakRssMB\": " << peakRssMB() << "\n";
+    out << "}\n";
+}
+
+int main(int argc, char** argv)
+{
+    LOG_INIT();
+
+    std::vector<std::string> positional;
+    bool prefetch = true, lod = true, meshCache = true;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--no-prefetch")
+            prefetch = false;
+        else if (std::string(argv[i]) == "--no-lod")
+            lod = false;
+        else if (std::string(argv[i]) == "--no-mesh-cache")
+            meshCache = false;
+        else
+            positional.emplace_back(argv[i]);
+    }
+
+    GameConfig config;
+    config.worldSeed = BENCH_SEED;
+    // the loader and the saver each open the save, an in-memory database would be a separate one for each
+    config.saveGamePath = (std::filesystem::temp_directory_path() / "VoxelGame_bench.db").string();
+    // sorting uploads the reordered faces, there is no GPU to upload to
+    config.sortTranslucentFaces = false;
+    if (positional.size() > 1)
+    {
+        config.renderDistance = std::stoul(positional[1]);
+        config.loadDistance = config.renderDistance + 2;
+    }
+    if (!lod)
+    {
+        config.lod1Distance = 0;
+        config.lod2Distance = 0;
+    }
+    if (!meshCache)
+        config.meshCacheMB = 0;
+
+    std::vector<PathResult> results;
+    for (const auto& path : FLIGHT_PATHS)
+    {
+        LOG_INFO("Running flight path {}", path.name);
+        results.push_back(runPath(path, config, prefetch));
+    }
+    removeSaveFile(config.saveGamePath);
+
+    if (!positional.empty())
+    {
+        std::ofstream file(positional[0]);
+        if (!file.is_open())
+        {
+            LOG_ERROR("Failed to open {}", positional[0]);
+            return 1;
+        }
+        writeJson(file, config, prefetch, results);
+    }
+    else
+        writeJson(std::cout, config, prefetch, results);
+
+    return 0;
+}
@@ -30,10 +30,11 @@ enum class BLOCK_TYPE
     LEAVES,
     PUMPKIN,
     MELON,
-    WATER
+    WATER,
+    LAMP
 };
 
-constexpr std::array<const char*, 13> BLOCK_NAMES = {
+constexpr std::array<const char*, 14> BLOCK_NAMES = {
     "Invalid",
     "Test",
     "Highlighted",
@@ -46,11 +47,32 @@ constexpr std::array<const char*, 13> BLOCK_NAMES = {
     "Leaves",
     "Pumpkin",
     "Melon",
-    "Water"
+    "Water",
+    "Lamp"
 };
 
-typedef GLuint blockdata;
-blockdata packBlockData(const glm::uvec3& positionInChunk, const glm::uvec2& atlasOffset, FACE face);
+// sky light in the low 4 bits and block light in the high 4 bits of a light byte, up to MAX_LIGHT each
+constexpr uint8_t MAX_LIGHT = 15;
+constexpr uint8_t SKY_LIGHT_MASK = 0x0F, BLOCK_LIGHT_SHIFT = 4;
+// full sky light and no block light, what faces get where nothing is known about the light
+constexpr uint8_t OPEN_SKY_LIGHT = MAX_LIGHT;
+// ambient occlusion of the 4 corners of a face, 2 bits each from 0 (both sides blocked) to 3 (nothing
+// next to the corner), in the corner order of BlockVert.glsl. Faces meshed without neighbourhood get this.
+constexpr uint8_t NO_OCCLUSION = 0xFF;
+
+// One face: position, texture and direction in the low word, the light in front of it and the occlusion
+// of its corners in the high word. Bound as a uvec2 instance attribute, two GLuints per face.
+typedef uint64_t blockdata;
+constexpr GLint BLOCKDATA_COMPONENTS = sizeof(blockdata) / sizeof(GLuint);
+blockdata packBlockData(const glm::uvec3& positionInChunk, const glm::uvec2& atlasOffset, FACE face, uint8_t light, uint8_t occlusion);
+glm::uvec3 unpackBlockPosition(blockdata data);
+FACE unpackBlockFace(blockdata data);
+uint8_t unpackBlockLight(blockdata data);
+uint8_t unpackBlockOcclusion(blockdata data);
 glm::uvec2 getAtlasOffset(BLOCK_TYPE block, FACE face);
 bool isTranslucent(BLOCK_TYPE block);
-bool isSolid(BLOCK_TYPE block);
\ No newline at end of file
+bool isSolid(BLOCK_TYPE block);
+// block light the block gives off
+uint8_t getLightEmission(BLOCK_TYPE block);
+// light lost passing into the block on top of the 1 per step, MAX_LIGHT stops it
+uint8_t getLightOpacity(BLOCK_TYPE block);
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "Block.h"
 #include "Config.h"
+#include "MemoryStats.h"
+#include "MeshBufferPool.h"
 #include "GameWorld.h"
 #include "Rendering.h"
 #include "VertexArray.h"
@@ -10,58 +12,313 @@
 #include "ThreadPool.h"
 #include "glm/fwd.hpp"
 #include "SQLiteCpp/Database.h"
+#include <mutex>
+
+struct WorldSaver;
+struct LightEngine;
+struct MeshCache;
+struct MeshUploader;
+struct UploadedMesh;
+struct SharedContext;
 
 struct Chunk
 {
     Chunk();
     Chunk(const glm::ivec3& chunkPosition, const WorldGenerationData& worldGenData);
-    void generateMeshData(const std::array<Chunk*, 6>& neighbourChunks);
+    void generateMeshData(const std::array<Chunk*, 6>& neighbourChunks, const std::array<Chunk*, 20>& diagonalChunks = {});
+    // uploads the mesh data, the CPU copy stays until releaseMeshData. ChunkManager::commitMesh marks it as drawn.
     void bakeMesh();
+    void releaseMeshData();
+    // the current mesh is outdated, mesh jobs started before this are thrown away
+    void invalidateMesh();
     BLOCK_TYPE getBlockUnsafe(const glm::ivec3& pos) const;
     BLOCK_TYPE getBlockSafe(const glm::ivec3& pos) const;
     void setBlockUnsafe(const glm::ivec3& pos, BLOCK_TYPE block);
     void setBlockSafe(const glm::ivec3& pos, BLOCK_TYPE block);
-    void spawnTree(const glm::ivec3& pos);
 
     static constexpr int32_t CHUNK_SIZE = 32;
     static constexpr int32_t BLOCKS_PER_CHUNK = CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE;
+    using BlockStorage = std::array<BLOCK_TYPE, BLOCKS_PER_CHUNK>;
+    using LightVoxels = std::array<uint8_t, BLOCKS_PER_CHUNK>;
+    using MeshData = std::vector<blockdata, TrackingAllocator<blockdata, CPU_MESH>>;
+    // faces per direction (BACK, FRONT, LEFT, RIGHT, BOTTOM, TOP) of an opaque mesh, which stores them in that order
+    using FaceCounts = std::array<uint32_t, 6>;
+
+    // Light bytes of all blocks (see MAX_LIGHT). Evenly lit chunks, open sky or solid rock, keep just the one
+    // value, the others a byte per block that jobs share like the blocks and that is copied on the first write.
+    struct LightStorage
+    {
+        uint8_t get(const uint32_t index) const { return voxels ? (*voxels)[index] : uniform; }
+        void set(uint32_t index, uint8_t light);
+        // takes the light of the whole chunk, only keeps the one value if it is even
+        void assign(const LightVoxels& light);
 
-    BLOCK_TYPE blocks[BLOCKS_PER_CHUNK];
-    std::vector<blockdata> meshDataOpaque, meshDataTranslucent;
+        std::shared_ptr<LightVoxels> voxels;
+        uint8_t uniform = 0;
+    };
+
+    // shared with autosave snapshots, copied on the first write while a snapshot holds it
+    std::shared_ptr<BlockStorage> blocks;
+    LightStorage light;
+    // bumped when light in the chunk went down or a block changed how light passes, light jobs that started
+    // before are thrown away since they may spread light that is gone
+    uint32_t lightRevision = 0;
+    MeshData meshDataOpaque, meshDataTranslucent;
     VertexArray vaoOpaque, vaoTranslucent;
+    TrackedMemory<GPU_BUFFERS> gpuMemory;
     glm::ivec3 chunkPosition;
-    bool isMeshBaked = false, isMeshDataReady = false, inRender = false;
+    uint32_t meshRevision = 0;
+    // level of detail the chunk should be meshed at and the one its uploaded mesh has, cells are 1 << lod blocks wide
+    uint32_t lod = 0, meshLod = 0;
+    // of meshDataOpaque and of the uploaded vaoOpaque
+    FaceCounts faceCounts{}, meshFaceCounts{};
+    // copy of the uploaded translucent faces in their current order, only kept with config.sortTranslucentFaces
+    // while the chunk is close enough to be sorted, a pending sort job holds it meanwhile
+    MeshData translucentFaces;
+    // mesh revision the copy belongs to and the camera position it was last sorted for
+    uint32_t translucentRevision = 0;
+    glm::vec3 translucentSortPos{0.0f};
+    bool isTranslucentSorted = false, isSortPending = false;
+    // neighbours in the world that are not lit yet, the chunk is only meshed once it is lit itself and this is 0
+    uint32_t missingNeighbours = 6;
+    // mesh jobs whose result this chunk took
+    uint32_t meshBuilds = 0;
+    // isMeshBaked: the uploaded mesh is up to date, hasMesh: there is an uploaded mesh to draw (maybe outdated)
+    bool isMeshBaked = false, isMeshDataReady = false, hasMesh = false, inRender = false, isDirty = false, isLit = false;
+    // lit with open sky above while the chunk above wasn't loaded, its sky light is corrected once that one is lit
+    bool hasAssumedSky = false;
 };
 
+// Block storage of a chunk frozen at a frame boundary, cheap to take since it only shares the storage
+struct ChunkSnapshot
+{
+    glm::ivec3 chunkPosition;
+    std::shared_ptr<const Chunk::BlockStorage> blocks;
+};
+
+// The 12 chunks sharing an edge with a chunk and the 8 sharing a corner, in the order the mesher takes them.
+// Only the corner occlusion reads them.
+constexpr std::array<glm::ivec3, 20> DIAGONAL_OFFSETS{{
+    {-1, -1, 0}, {1, -1, 0}, {-1, 1, 0}, {1, 1, 0}, {0, -1, -1}, {0, 1, -1}, {0, -1, 1}, {0, 1, 1},
+    {-1, 0, -1}, {1, 0, -1}, {-1, 0, 1}, {1, 0, 1},
+    {-1, -1, -1}, {1, -1, -1}, {-1, 1, -1}, {1, 1, -1}, {-1, -1, 1}, {1, -1, 1}, {-1, 1, 1}, {1, 1, 1}}};
+
+// Calls func with the positions of the blocks of the neighbour at offset (-1, 0 or 1 per axis) that touch the
+// chunk: a slab for a face neighbour, a row for an edge and a single block for a corner
+template<typename F>
+void forEachTouchingBlock(const glm::ivec3& offset, F&& func)
+{
+    constexpr int32_t SIZE = Chunk::CHUNK_SIZE;
+    glm::ivec3 min{0}, max{SIZE};
+    for (int32_t axis = 0; axis < 3; axis++)
+    {
+        if (offset[axis] == 0)
+            continue;
+        min[axis] = offset[axis] < 0 ? SIZE - 1 : 0;
+        max[axis] = min[axis] + 1;
+    }
+    for (int32_t z = min.z; z < max.z; z++)
+        for (int32_t y = min.y; y < max.y; y++)
+            for (int32_t x = min.x; x < max.x; x++)
+                func(glm::ivec3{x, y, z});
+}
+
+// Meshes blocks against its neighbours (BACK, FRONT, LEFT, RIGHT, BOTTOM, TOP, null if not loaded),
+// only reads the storages so it can run on snapshots. Opaque faces come grouped by direction. Every face
+// takes the light of the block in front of it, past a null neighbourLight that is open sky. The diagonal
+// neighbours (see DIAGONAL_OFFSETS) only shade the corners along the chunk's edges, null ones count as open.
+void generateMeshData(const Chunk::BlockStorage& blocks, const std::array<const Chunk::BlockStorage*, 6>& neighbours,
+                      const std::array<const Chunk::BlockStorage*, 20>& diagonals,
+                      const Chunk::LightStorage& light, const std::array<const Chunk::LightStorage*, 6>& neighbourLight,
+                      Chunk::MeshData& meshDataOpaque, Chunk::MeshData& meshDataTranslucent, Chunk::FaceCounts& faceCountsOpaque);
+// Same for a mesh of (1 << lod)^3 block cells, each cell takes its majority block. Faces towards null
+// neighbours are kept, which closes the seams to neighbours at another level of detail. The faces are
+// lit as open sky, these chunks are too far away for caves to show.
+void generateLodMeshData(const Chunk::BlockStorage& blocks, const std::array<const Chunk::BlockStorage*, 6>& neighbours, uint32_t lod,
+                         Chunk::MeshData& meshDataOpaque, Chunk::MeshData& meshDataTranslucent, Chunk::FaceCounts& faceCountsOpaque);
+
+// Generates the unmodified terrain of a chunk
+void generateTerrain(Chunk::BlockStorage& blocks, const glm::ivec3& chunkPosition, const WorldGenerationData& worldGenData);
+
 glm::ivec3 chunkPosToWorldBlockPos(const glm::ivec3& chunkPos);
 glm::ivec3 worldPosToChunkBlockPos(const glm::ivec3& worldPos);
 glm::ivec3 worldPosToChunkPos(const glm::ivec3& worldPos);
 bool isChunkCoord(const glm::ivec3& pos);
 
-template<>
-struct std::hash<glm::ivec3>
+// Where streaming looks ahead to, velocity in blocks per second
+struct StreamingFocus
 {
-    size_t operator()(const glm::ivec3& v) const noexcept
-    {
-        const size_t h1 = hash<int>{}(v.x);
-        const size_t h2 = hash<int>{}(v.y);
-        const size_t h3 = hash<int>{}(v.z);
-        return h1 ^ (h2 << 1) ^ (h3 << 2);
-    }
+    glm::vec3 position{0.0f}, velocity{0.0f}, lookDir{0.0f, 0.0f, -1.0f};
+};
+
+// A generation or mesh job that has been queued but not collected yet
+struct PendingJob
+{
+    CancellationToken token;
+    uint32_t meshRevision = 0;
+};
+
+struct GeneratedChunk
+{
+    CancellationToken token;
+    Chunk chunk;
+    float ms;
+};
+
+struct LitChunk
+{
+    CancellationToken token;
+    glm::ivec3 position;
+    Chunk::LightStorage light;
+    // of the neighbours (BACK..TOP, NOT_LIT if they weren't lit) and of the chunk itself when the job was queued
+    std::array<uint32_t, 7> lightRevisions;
+    float ms;
+
+    static constexpr uint32_t NOT_LIT = ~0u;
+};
+
+struct GeneratedMesh
+{
+    CancellationToken token;
+    glm::ivec3 position;
+    Chunk::MeshData meshDataOpaque, meshDataTranslucent;
+    Chunk::FaceCounts faceCountsOpaque{};
+    float ms;
+    // taken from the mesh cache, cachedMs is what generating it once cost. cacheMs is the time spent
+    // hashing, looking up and inserting, paid on hits and misses.
+    bool isCached = false;
+    float cachedMs = 0.0f, cacheMs = 0.0f;
+};
+
+// Translucent faces of a chunk sorted back to front for cameraPos
+struct SortedFaces
+{
+    glm::ivec3 position;
+    uint32_t meshRevision;
+    glm::vec3 cameraPos;
+    Chunk::MeshData faces;
+    // false if the previous order still held, nothing needs to be uploaded then
+    bool changed;
 };
 
 struct ChunkManager
 {
     ChunkManager(const GameConfig& config);
-    void unloadChunks(const glm::ivec3& currChunkPos);
-    void drawChunks(Renderer& renderer, const glm::mat4& viewProjection, float exposure);
-    void bakeChunks(const glm::ivec3& currChunkPos);
-    void loadChunks(const glm::ivec3& currChunkPos, SQLite::Database& db);
+    ~ChunkManager();
+    // the streaming functions return how many chunks they processed, at most the given quota
+    uint32_t unloadChunks(const glm::ivec3& currChunkPos, WorldSaver& saver, uint32_t maxUnloads);
+    // returns the number of chunks drawn, opaque face directions that can't face the camera are skipped.
+    // Renderer::beginFrame has to be called first.
+    uint32_t drawChunks(Renderer& renderer, const glm::vec3& cameraPos);
+    // Generation and meshing run on the workers across frames, both collect finished jobs first and
+    // cancel jobs for chunks that left their radius. Needs no GL context.
+    uint32_t meshChunks(const glm::ivec3& currChunkPos, uint32_t maxMeshes);
+    // uploads meshes in the order they finished until the quota or config.uploadBudgetKB is used up,
+    // with an upload thread it hands them all over and attaches up to the quota of finished ones
+    uint32_t uploadMeshes(uint32_t maxUploads);
+    // the bookkeeping once a chunk's mesh data is on the GPU: level, face counts, the translucent copy for sorting,
+    // then the mesh data is released. Needs no GL context, the headless benchmark commits meshes it never uploads.
+    void commitMesh(Chunk& chunk, const Chunk::FaceCounts& faceCountsOpaque, Chunk::MeshData&& translucentFaces);
+    // queues back to front sorts of the translucent faces of nearby chunks once the camera moved far enough
+    // from where they were last sorted and uploads finished ones, returns the number uploaded
+    uint32_t sortTranslucentFaces(const glm::vec3& cameraPos);
+    // false if the shared context couldn't be created (Window::createSharedContext), uploads then stay on this thread
+    bool startUploadThread(SharedContext&& context);
+    uint32_t loadChunks(const glm::ivec3& currChunkPos, SQLite::Database& db, const WorldSaver& saver, uint32_t maxLoads);
     void dropChunkMeshes();
+    // remeshes a chunk whose neighbours changed
+    void invalidateMesh(Chunk& chunk);
+    // edits a block, remeshes the chunk and only the neighbours whose meshes read that block, then relights
+    // what the block changed and remeshes the chunks that light reaches
+    void setBlock(Chunk& chunk, const glm::ivec3& positionInChunk, BLOCK_TYPE block);
+    // takes the light of a chunk lit on its own (see fillChunkLight), lets it flow to and from the lit
+    // neighbours and queues the chunk below to be lit next. A chunk below lit under open sky
+    // (Chunk::hasAssumedSky) loses the sky light this one doesn't let through.
+    void setChunkLight(Chunk& chunk, Chunk::LightStorage&& light);
+    void markDirty(Chunk& chunk);
+    std::vector<ChunkSnapshot> snapshotDirtyChunks();
     Chunk* getChunk(const glm::ivec3& pos);
 
     ThreadPool threadPool;
     std::unordered_map<glm::ivec3, Chunk> chunks;
+    MeshBufferPool meshBuffers;
+    std::vector<glm::ivec3> dirtyChunks;
     const GameConfig& config;
     WorldGenerationData worldGenData;
+    // effective render distance, at most config.renderDistance
+    uint32_t renderDistance;
+    // loading and meshing prioritise chunks around the predicted position
+    StreamingFocus focus;
+
+    // Streaming only reacts to the player entering another chunk: the shells that entered or left
+    // the load and render cubes are queued then, steady state frames only look at these queues.
+    std::vector<glm::ivec3> loadQueue, unloadQueue, meshQueue;
+    // chunks with finished mesh data waiting for upload, and the mesh bytes the last uploadMeshes uploaded
+    std::vector<glm::ivec3> uploadQueue;
+    size_t uploadedBytes = 0;
+    std::unique_ptr<MeshUploader> meshUploader;
+    // null with config.meshCacheMB = 0
+    std::unique_ptr<MeshCache> meshCache;
+    // Chunks are lit top down by column: a loaded chunk is queued once the chunk above is lit or there is
+    // open sky above it, the light jobs run in parallel over the columns
+    std::vector<glm::ivec3> lightQueue;
+    std::unique_ptr<LightEngine> lightEngine;
+    // finished on the upload thread, waiting for the quota to be attached
+    std::vector<UploadedMesh> uploadedMeshes;
+    // mesh revision handed to the upload thread per chunk
+    std::unordered_map<glm::ivec3, uint32_t> pendingUploads;
+    glm::ivec3 frontierCenter{0};
+    int32_t frontierRenderRadius = 0;
+    bool hasFrontier = false;
+
+    std::unordered_map<glm::ivec3, PendingJob> pendingLoads, pendingMeshes, pendingLights;
+    // filled by the workers, collected on the main thread
+    std::mutex finishedMutex;
+    std::vector<GeneratedChunk> generatedChunks;
+    std::vector<LitChunk> litChunks;
+    std::vector<GeneratedMesh> generatedMeshes;
+    std::vector<SortedFaces> sortedFaces;
+    // freshly uploaded chunks whose translucent faces are still in mesh order
+    std::vector<glm::ivec3> sortQueue;
+    glm::vec3 sortCameraPos{0.0f};
+    glm::ivec3 sortCameraChunk{0};
+    bool hasSortCamera = false;
+    uint64_t sortsUploaded = 0, sortsKept = 0;
+    // visible chunks by distance to the camera, rebuilt by every drawChunks
+    std::vector<std::pair<float, const Chunk*>> drawList;
+    // offset and mesh cell width per drawList entry, the draws index into it
+    std::vector<glm::vec4> drawOffsets;
+    // chunks and faces (instances) drawn per level of detail by the last drawChunks
+    static constexpr uint32_t LOD_COUNT = 3;
+    std::array<uint32_t, LOD_COUNT> drawnPerLod{};
+    std::array<uint64_t, LOD_COUNT> facesPerLod{};
+    // opaque faces drawn and skipped as back-facing by the last drawChunks
+    uint64_t drawnFaces = 0, skippedFaces = 0;
+    // mesh jobs served from the mesh cache and the generation time that saved, net of hashing and lookups
+    uint64_t meshCacheHits = 0, meshCacheMisses = 0;
+    double meshCacheSavedMs = 0.0;
+    // accepted mesh results and the chunks that got at least one, their ratio is the meshes built per chunk
+    uint64_t meshesBuilt = 0, chunksWithMesh = 0;
+    // edits that changed light, the voxels they relit and the time that took, in total and of the last one
+    uint64_t relights = 0, relitVoxels = 0;
+    double relightMs = 0.0, lastRelightMs = 0.0;
+    uint32_t lastRelitVoxels = 0;
+    // jobs that ran to completion but whose result was thrown away
+    uint64_t wastedJobs = 0;
+    double wastedJobMs = 0.0;
+private:
+    void updateFrontier(const glm::ivec3& currChunkPos);
+    uint32_t attachUploadedMeshes(uint32_t maxUploads);
+    void discardJob(float ms);
+    // takes the translucent faces of a mesh that was just uploaded as the chunk's copy for sorting if it is
+    // in the sort radius or one chunk past it, further out they are dropped
+    void keepTranslucentFaces(Chunk& chunk, Chunk::MeshData&& faces);
+    // remeshes the chunk and its neighbours if the level changed
+    void setChunkLod(Chunk& chunk, uint32_t lod);
+    // the chunk above is lit, out of the world, or out of the load cube and taken as open sky until it is lit
+    bool canLight(const glm::ivec3& chunkPos);
+    void collectLitChunks();
+    void queueLightJobs(const glm::ivec3& currChunkPos);
+    // runs the queued light updates and remeshes every chunk whose mesh reads light that changed
+    uint32_t propagateLight();
 };
\ No newline at end of file
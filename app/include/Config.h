@@ -12,6 +12,29 @@ struct GameConfig
     uint32_t maxBakesPerFrame = threadCount - 1;
     uint32_t worldSeed = std::chrono::steady_clock::now().time_since_epoch().count();
     float reachDistance = 16.0f;
+    uint32_t compactionThreshold = 256;
+    float autosaveInterval = 30.0f;
+    // the streaming quotas adapt to fit the frame into this, the max*PerFrame values are upper bounds
+    float frameBudgetMs = 16.6f;
+    // lowers the render distance down to minRenderDistance while frames miss the budget
+    bool dynamicRenderDistance = false;
+    uint32_t minRenderDistance = 4;
+    // mesh bytes uploaded per frame, a single larger mesh still goes through alone
+    uint32_t uploadBudgetKB = 1024;
+    // uploads meshes on a separate thread with a shared GL context, falls back to the render thread if that fails
+    bool uploadThread = false;
+    // chunks at least this many chunks away are meshed from 2x and 4x downsampled blocks, 0 turns a level off
+    uint32_t lod1Distance = 12;
+    uint32_t lod2Distance = 20;
+    // heightfield-only terrain fills the view from the render distance out to this many chunks from the player, 0 turns it off
+    uint32_t horizonDistance = 48;
+    // re-sorts the translucent faces of nearby chunks back to front on the workers as the camera moves
+    bool sortTranslucentFaces = true;
+    // finished meshes are kept by content so unchanged chunks are never meshed twice, 0 turns the cache off
+    uint32_t meshCacheMB = 64;
+    // evicted meshes are spilled to this file and reused in later sessions, empty keeps them in memory only
+    std::string meshCacheFile = "";
+    uint32_t meshCacheFileMB = 256;
 };
 
 bool loadConfig(const char* path, GameConfig& config);
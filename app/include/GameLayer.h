@@ -2,14 +2,18 @@
 #include "Chunk.h"
 #include "Layer.h"
 #include "Entity.h"
+#include "HorizonTerrain.h"
 #include "Rendering.h"
+#include "RenderDistanceController.h"
+#include "StreamingScheduler.h"
+#include "WorldSaver.h"
 
 class GameLayer final : public core::Layer
 {
 friend class DebugLayer;
 public:
     GameLayer(const std::string& name, const GameConfig& config);
-    ~GameLayer() override = default;
+    ~GameLayer() override;
     void onUpdate(double dt) override;
     void onRender() override;
     bool onEvent(core::Event& e) override;
@@ -23,7 +27,14 @@ private:
     Renderer m_Renderer;
     Camera m_Cam;
     ChunkManager m_ChunkManager;
+    // after the chunk manager, whose workers it shares
+    HorizonTerrain m_Horizon;
+    StreamingScheduler m_Scheduler;
+    RenderDistanceController m_RenderDistanceController;
+    uint32_t m_DrawnChunks = 0;
     SQLite::Database m_Database;
+    WorldSaver m_WorldSaver;
+    double m_TimeSinceAutosave = 0.0;
     EntityManager m_EntityManager;
     PhysicsObject m_PlayerPhysics;
     bool m_PlayerGrounded = false;
@@ -5,16 +5,37 @@
 #include "glm/vec2.hpp"
 #include "glm/vec3.hpp"
 #include "SQLiteCpp/Database.h"
+#include <functional>
+
+template<>
+struct std::hash<glm::ivec3>
+{
+    size_t operator()(const glm::ivec3& v) const noexcept
+    {
+        const size_t h1 = hash<int>{}(v.x);
+        const size_t h2 = hash<int>{}(v.y);
+        const size_t h3 = hash<int>{}(v.z);
+        return h1 ^ (h2 << 1) ^ (h3 << 2);
+    }
+};
 
 SQLite::Database initDB(const std::string& dbPath);
-void saveBlockChanges(SQLite::Database& db, const glm::ivec3& chunkPos, const glm::ivec3& positionInChunk, BLOCK_TYPE blockType);
 
 struct BlockChange
 {
     glm::ivec3 positionInChunk;
     BLOCK_TYPE blockType;
 };
+// Returns the compacted diff of the chunk followed by the newer journal rows, apply in order. Only saves from
+// before whole chunk diffs have journal rows, nothing writes them any more.
 std::vector<BlockChange> getBlockChangesForChunk(SQLite::Database& db, const glm::ivec3& chunkPos);
+// Folds the journal rows of a chunk (see above) into its diff blob if there are at least threshold rows
+bool compactBlockChanges(SQLite::Database& db, const glm::ivec3& chunkPos, uint32_t threshold);
+// Replaces everything saved for a chunk, changes holds one entry per voxel with INVALID where it matches the terrain
+void saveChunkDiff(SQLite::Database& db, const glm::ivec3& chunkPos, const std::vector<BLOCK_TYPE>& changes);
+
+// Maps the primary, secondary and biome noise values in [-1, 1] to a terrain height
+uint32_t noiseToHeight(float primaryValue, float secondaryValue, float biomeValue);
 
 struct WorldGenerationData
 {
@@ -0,0 +1,89 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "Chunk.h"
+#include "Config.h"
+#include "MemoryStats.h"
+#include "ThreadPool.h"
+#include "VertexArray.h"
+
+class Renderer;
+
+struct HorizonVertex
+{
+    glm::vec3 position;
+    // sRGB surface colour in the low bytes, the baked lighting / 2 in the high byte
+    uint32_t color;
+};
+
+// Samples a tile of the far terrain from the height function alone, (TILE_CELLS + 1)^2 vertices in rows along x
+void generateHorizonTile(const WorldGenerationData& worldGenData, const glm::ivec2& tilePos, std::vector<HorizonVertex>& vertices);
+
+// Far terrain out to config.horizonDistance chunks without any voxel chunks: coarse heightfield tiles with
+// a surface colour, generated on the chunk workers after all chunk jobs and drawn in one call from a
+// shared buffer. Everything inside the render cube is left to the real chunks.
+struct HorizonTerrain
+{
+    static constexpr int32_t TILE_CHUNKS = 4;
+    static constexpr int32_t TILE_BLOCKS = TILE_CHUNKS * Chunk::CHUNK_SIZE;
+    static constexpr int32_t TILE_CELLS = 16;
+    static constexpr int32_t CELL_BLOCKS = TILE_BLOCKS / TILE_CELLS;
+    static constexpr int32_t TILE_VERTICES = (TILE_CELLS + 1) * (TILE_CELLS + 1);
+    static constexpr int32_t TILE_INDICES = TILE_CELLS * TILE_CELLS * 6;
+    static constexpr uint32_t MAX_UPLOADS_PER_FRAME = 16;
+
+    HorizonTerrain(const GameConfig& config, ThreadPool& threadPool);
+    ~HorizonTerrain();
+    // queues the tiles around the player that the render cube doesn't cover, drops the rest and uploads
+    // finished tiles, returns how many were uploaded. Needs the GL context.
+    uint32_t update(const glm::ivec3& currChunkPos, uint32_t renderDistance);
+    void draw(Renderer& renderer);
+
+    struct Tile
+    {
+        CancellationToken token;
+        // vertex slot in the shared buffer, -1 until uploaded
+        int32_t slot = -1;
+    };
+
+    struct GeneratedTile
+    {
+        CancellationToken token;
+        glm::ivec2 tilePos;
+        std::vector<HorizonVertex> vertices;
+    };
+
+    // shared with the jobs, so a job still running when the horizon is destroyed has somewhere to write
+    struct Results
+    {
+        std::mutex mutex;
+        std::vector<GeneratedTile> tiles;
+    };
+
+    struct TileHash
+    {
+        size_t operator()(const glm::ivec2& v) const noexcept { return std::hash<uint64_t>{}(uint64_t(uint32_t(v.x)) << 32 | uint32_t(v.y)); }
+    };
+
+    const GameConfig& config;
+    ThreadPool& threadPool;
+    std::shared_ptr<const WorldGenerationData> worldGenData;
+    std::shared_ptr<Results> results;
+    std::unordered_map<glm::ivec2, Tile, TileHash> tiles;
+    // one vertex buffer with a slot per tile and one index buffer used by all of them
+    VertexArray vao;
+    std::vector<int32_t> freeSlots;
+    TrackedMemory<GPU_BUFFERS> gpuMemory;
+    glm::ivec3 center{0};
+    int32_t renderRadius = 0;
+    bool hasCenter = false;
+    uint32_t uploadedTiles = 0;
+    std::vector<GLsizei> drawCounts;
+    std::vector<const void*> drawIndices;
+    std::vector<GLint> drawBaseVertices;
+private:
+    void updateTiles(const glm::ivec3& currChunkPos, int32_t render);
+    void createBuffers();
+};
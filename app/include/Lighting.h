@@ -0,0 +1,48 @@
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "Chunk.h"
+
+// Lights a chunk on its own from the light flowing in over its borders: the light of its lit neighbours
+// (BACK, FRONT, LEFT, RIGHT, BOTTOM, TOP, null if not lit), full sky light from above with openSky and no
+// neighbour on top, and its light sources. Light that would flow out is left to LightEngine::queueBorderExchange.
+void fillChunkLight(const Chunk::BlockStorage& blocks, const std::array<const Chunk::LightStorage*, 6>& neighbours, bool openSky,
+                    Chunk::LightStorage& light);
+
+// Relights the lit chunks on the main thread. Removals spread out from where light was lost until they
+// meet light from elsewhere, the additions then spread that back in, so only voxels whose light changes
+// are touched, across chunk borders as far as the light goes. Chunks that are not lit stop both.
+struct LightEngine
+{
+    explicit LightEngine(std::unordered_map<glm::ivec3, Chunk>& chunks);
+    // after the block at worldPos was replaced by one that lets light through or gives it off differently
+    void queueBlockChange(const glm::ivec3& worldPos);
+    // lets light flow both ways between a chunk that was just lit and its lit neighbours
+    void queueBorderExchange(const Chunk& chunk);
+    // once the chunk above a chunk lit under open sky is lit, takes back the sky light its top layer got
+    // where the chunk above lets less through
+    void queueSkyCorrection(Chunk& chunk);
+    // runs everything queued, returns the number of voxels whose light changed since the last call
+    uint32_t propagate();
+
+    // chunks whose meshes read light that changed since the last propagate, each once after it. Cleared by the caller.
+    std::vector<glm::ivec3> changedChunks;
+private:
+    struct LightNode
+    {
+        glm::ivec3 pos;
+        // the level that was removed, unused by additions which spread the current level
+        uint8_t level;
+    };
+
+    Chunk* getLitChunk(const glm::ivec3& chunkPos);
+    void setLevel(Chunk& chunk, const glm::ivec3& worldPos, uint32_t index, uint32_t channel, uint8_t level);
+
+    std::unordered_map<glm::ivec3, Chunk>& m_Chunks;
+    // sky and block light
+    std::array<std::vector<LightNode>, 2> m_Removals, m_Additions;
+    // the passes mostly stay within a chunk, the last lookup is kept
+    glm::ivec3 m_CachedPos{0};
+    Chunk* m_CachedChunk = nullptr;
+    uint32_t m_ChangedVoxels = 0;
+};
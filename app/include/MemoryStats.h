@@ -0,0 +1,98 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+enum MEMORY_CATEGORY
+{
+    VOXEL_STORAGE,
+    CPU_MESH,
+    GPU_BUFFERS,
+    SQLITE,
+    MESH_CACHE,
+    LIGHT_STORAGE,
+    MEMORY_CATEGORY_COUNT
+};
+
+constexpr std::array<const char*, MEMORY_CATEGORY_COUNT> MEMORY_CATEGORY_NAMES = {
+    "Voxel Storage",
+    "CPU Meshes",
+    "GPU Buffers",
+    "SQLite",
+    "Mesh Cache",
+    "Light"
+};
+
+struct MemoryUsage
+{
+    int64_t bytes = 0, objects = 0;
+};
+
+// counters are updated where memory is (de)allocated, reading them never scans
+void trackMemory(MEMORY_CATEGORY category, int64_t bytes, int64_t objects);
+MemoryUsage getMemoryUsage(MEMORY_CATEGORY category);
+
+// Stateless allocator that reports every allocation to its category
+template<typename T, MEMORY_CATEGORY C>
+struct TrackingAllocator
+{
+    using value_type = T;
+    template<typename U> struct rebind { using other = TrackingAllocator<U, C>; };
+
+    TrackingAllocator() = default;
+    template<typename U> TrackingAllocator(const TrackingAllocator<U, C>&) noexcept {}
+
+    T* allocate(const size_t n)
+    {
+        trackMemory(C, int64_t(n * sizeof(T)), 1);
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, const size_t n) noexcept
+    {
+        trackMemory(C, -int64_t(n * sizeof(T)), -1);
+        ::operator delete(p);
+    }
+
+    template<typename U> bool operator==(const TrackingAllocator<U, C>&) const noexcept { return true; }
+};
+
+// Reports a size owned outside of the C++ heap (e.g. GPU buffers), moves with its owner and releases on destruction
+template<MEMORY_CATEGORY C>
+class TrackedMemory
+{
+public:
+    TrackedMemory() = default;
+    ~TrackedMemory() { set(0, 0); }
+    TrackedMemory(const TrackedMemory&) = delete;
+    TrackedMemory& operator=(const TrackedMemory&) = delete;
+    TrackedMemory(TrackedMemory&& other) noexcept : m_Bytes(other.m_Bytes), m_Objects(other.m_Objects)
+    {
+        other.m_Bytes = 0;
+        other.m_Objects = 0;
+    }
+    TrackedMemory& operator=(TrackedMemory&& other) noexcept
+    {
+        if (this == &other)
+            return *this;
+
+        set(0, 0);
+        m_Bytes = other.m_Bytes;
+        m_Objects = other.m_Objects;
+        other.m_Bytes = 0;
+        other.m_Objects = 0;
+        return *this;
+    }
+
+    void set(const int64_t bytes, const int64_t objects)
+    {
+        if (bytes != m_Bytes || objects != m_Objects)
+            trackMemory(C, bytes - m_Bytes, objects - m_Objects);
+        m_Bytes = bytes;
+        m_Objects = objects;
+    }
+private:
+    int64_t m_Bytes = 0, m_Objects = 0;
+};
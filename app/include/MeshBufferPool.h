@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include "MemoryStats.h"
+#include "VertexArray.h"
+
+// Vertex arrays of unloaded chunks. Later uploads take them over with their buffer instead of creating
+// new ones, whatever the pool can't hold is deleted a few per frame rather than all at once on unload.
+struct MeshBufferPool
+{
+    // a released vertex array may still be read by frames the GPU hasn't finished yet
+    static constexpr uint64_t FRAMES_IN_FLIGHT = 3;
+    static constexpr size_t MAX_POOLED = 256;
+    static constexpr uint32_t MAX_DELETES_PER_FRAME = 8;
+
+    void release(VertexArray&& vao);
+    // the oldest released vertex array the GPU is done with, or an empty one
+    VertexArray acquire();
+    // advances the frame and deletes part of the surplus, needs the GL context
+    void update();
+
+    struct PooledVertexArray
+    {
+        VertexArray vao;
+        uint64_t releasedFrame;
+        int64_t bytes;
+    };
+
+    std::deque<PooledVertexArray> released;
+    uint64_t frame = 0;
+    uint64_t reused = 0, deleted = 0;
+    TrackedMemory<GPU_BUFFERS> memory;
+    int64_t pooledBytes = 0;
+};
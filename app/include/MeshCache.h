@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Chunk.h"
+#include "SQLiteCpp/Database.h"
+
+// 128 bit hash of everything a mesh is generated from
+struct MeshCacheKey
+{
+    uint64_t low = 0, high = 0;
+
+    bool operator==(const MeshCacheKey& other) const = default;
+};
+
+// Hashes the blocks of a chunk, the slabs of its neighbours the mesher reads (1 << lod blocks deep, missing
+// neighbours hash differently from air) and the level of detail. At level 0 the light of the chunk and the
+// neighbour cells next to it go in as well, and the edges and corners of the diagonal neighbours its corner
+// occlusion reads. The other levels are meshed without either.
+MeshCacheKey hashPaddedVolume(const Chunk::BlockStorage& blocks, const std::array<const Chunk::BlockStorage*, 6>& neighbours,
+                              const std::array<const Chunk::BlockStorage*, 20>& diagonals,
+                              const Chunk::LightStorage& light, const std::array<const Chunk::LightStorage*, 6>& neighbourLight, uint32_t lod);
+
+// Finished meshes by the content they were generated from, so a chunk whose blocks and borders did not change
+// is never meshed twice: after dropChunkMeshes, when walking back into an area or, with a cache file, in a later
+// session. An LRU bounded by capacityBytes in memory, evicted entries are spilled to the file in batches and
+// whatever is still in memory is written on destruction. Thread safe, the mesh jobs use it directly.
+struct MeshCache
+{
+    using Faces = std::vector<blockdata, TrackingAllocator<blockdata, MESH_CACHE>>;
+    // bump when the mesher output changes, files of another version are cleared on open
+    static constexpr int32_t FILE_VERSION = 4;
+    static constexpr size_t SPILL_BATCH = 64;
+
+    // an empty filePath keeps the cache in memory, the file is trimmed to fileCapacityBytes when opened
+    MeshCache(size_t capacityBytes, const std::string& filePath, size_t fileCapacityBytes);
+    ~MeshCache();
+    // copies a cached mesh into the mesh data and face counts of mesh, returns what generating it once cost
+    std::optional<float> find(const MeshCacheKey& key, GeneratedMesh& mesh);
+    void insert(const MeshCacheKey& key, const GeneratedMesh& mesh, float meshMs);
+
+    struct Entry
+    {
+        MeshCacheKey key;
+        Faces opaque, translucent;
+        Chunk::FaceCounts faceCounts{};
+        float meshMs = 0.0f;
+        // the file has this entry already, it is not spilled again
+        bool isStored = false;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const MeshCacheKey& key) const noexcept { return size_t(key.low); }
+    };
+
+    size_t capacityBytes, bytes = 0;
+    // most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<MeshCacheKey, std::list<Entry>::iterator, KeyHash> index;
+    // evicted, waiting to be written to the file
+    std::vector<Entry> spilled;
+    std::mutex mutex;
+    // null without a cache file or if it could not be opened, only used under fileMutex
+    std::unique_ptr<SQLite::Database> db;
+    std::mutex fileMutex;
+    std::atomic<uint64_t> fileHits = 0, spilledEntries = 0;
+private:
+    void store(Entry&& entry);
+    std::optional<Entry> readEntry(const MeshCacheKey& key);
+    void writeEntries(const std::vector<Entry>& written);
+};
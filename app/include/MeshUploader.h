@@ -0,0 +1,52 @@
+#pragma once
+#include "Chunk.h"
+#include "SharedContext.h"
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+struct MeshUpload
+{
+    glm::ivec3 position;
+    uint32_t meshRevision;
+    Chunk::MeshData meshDataOpaque, meshDataTranslucent;
+    Chunk::FaceCounts faceCountsOpaque{};
+};
+
+struct UploadedMesh
+{
+    glm::ivec3 position;
+    uint32_t meshRevision;
+    GLuint bufferOpaque, bufferTranslucent;
+    GLuint vertexCountOpaque, vertexCountTranslucent;
+    GLsync fence;
+    Chunk::FaceCounts faceCountsOpaque{};
+    // handed back for translucent sorting, the chunk copy is only taken once the buffers are attached
+    Chunk::MeshData meshDataTranslucent;
+};
+
+// Uploads meshes on its own thread through a context shared with the window. Buffers are shared between
+// contexts but vertex arrays are not, the render thread attaches the buffers once their fence has signalled.
+struct MeshUploader
+{
+    // takes ownership of a context made by Window::createSharedContext, must be destroyed on the main thread
+    explicit MeshUploader(SharedContext&& context);
+    ~MeshUploader();
+    void queueUpload(MeshUpload&& upload);
+    // uploads the GPU has finished (their fence is already deleted), the others stay for a later call.
+    // Needs the main context.
+    std::vector<UploadedMesh> collectUploads();
+
+    SharedContext context;
+    std::queue<MeshUpload> uploads;
+    std::vector<UploadedMesh> uploaded;
+    std::mutex queueMutex;
+    std::condition_variable_any queueCondition;
+    std::jthread thread;
+private:
+    void threadLoop(const std::stop_token& st);
+};
+
+// no longer needed, also deletes the fence
+void deleteUploadedMesh(const UploadedMesh& mesh);
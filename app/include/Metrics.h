@@ -1,11 +1,17 @@
 #pragma once
 #include "RingBuffer.h"
-#include <string>
-#include <unordered_map>
-#include "Application.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include "imgui.h"
+#include "Trace.h"
 
 const size_t SAMPLE_COUNT = 500;
+const size_t MAX_METRICS = 64;
+const size_t THREAD_SAMPLE_CAPACITY = 4096;
+
+using MetricID = uint32_t;
 
 struct MetricData
 {
@@ -17,20 +23,68 @@ struct MetricData
         color.w = 1.0f;
     }
 
+    const char* name = nullptr;
     RingBuffer<double, SAMPLE_COUNT> values;
     ImVec4 color;
 };
 
+struct MetricSummary
+{
+    double p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+};
+
+struct MetricSample
+{
+    MetricID id;
+    float ms;
+};
+
+// single producer (the owning thread), single consumer (the main thread in mergeMetricSamples)
+struct ThreadSampleRing
+{
+    std::array<MetricSample, THREAD_SAMPLE_CAPACITY> samples;
+    std::atomic<uint32_t> head = 0, tail = 0;
+};
+
+// ids are handed out once per CAPTURE site, the name must outlive the program (string literal)
+MetricID registerMetric(const char* name);
+void pushMetricSample(MetricID id, float ms);
+// main thread only, drains every thread ring into the per-metric sample windows
+void mergeMetricSamples();
+size_t getMetricCount();
+MetricData& getMetric(MetricID id);
+MetricSummary summarizeMetric(MetricData& data);
+
+class ScopedMetric
+{
+public:
+    explicit ScopedMetric(const MetricID id) : m_ID(id), m_Start(std::chrono::steady_clock::now()) {}
+    ~ScopedMetric()
+    {
+        const auto end = std::chrono::steady_clock::now();
+        const std::chrono::duration<float, std::milli> ms = end - m_Start;
+        pushMetricSample(m_ID, ms.count());
+        if (isTraceRecording())
+            recordTraceEvent(getMetric(m_ID).name, "capture", m_Start, end);
+    }
+private:
+    MetricID m_ID;
+    std::chrono::steady_clock::time_point m_Start;
+};
+
+#define METRIC_CONCAT_INNER(a, b) a##b
+#define METRIC_CONCAT(a, b) METRIC_CONCAT_INNER(a, b)
+
 #ifdef NOPROFILE
     #define CAPTURE(name, func) func;
+    #define CAPTURE_SCOPE(name)
 #else
-    inline std::unordered_map<std::string, MetricData> metrics;
+    #define CAPTURE_SCOPE(name) \
+        static const MetricID METRIC_CONCAT(metricID_, __LINE__) = registerMetric(name); \
+        const ScopedMetric METRIC_CONCAT(scopedMetric_, __LINE__)(METRIC_CONCAT(metricID_, __LINE__))
 
     #define CAPTURE(name, func) { \
-        double start = core::Application::get().getTime(); \
+        CAPTURE_SCOPE(name); \
         func; \
-        double end = core::Application::get().getTime(); \
-        double ms = (end - start) * 1000.0; \
-        metrics[name].values.push(ms); \
     }
 #endif
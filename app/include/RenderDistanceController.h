@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include "Config.h"
+
+// Raises or lowers the effective render distance to hold the frame budget. Shrinking only hides chunks,
+// they stay loaded up to the load distance, so a short dip does not cost a reload.
+struct RenderDistanceController
+{
+    explicit RenderDistanceController(const GameConfig& config);
+    // frameMs is the full frame time, workMs the cpu time spent in update and render
+    uint32_t update(double frameMs, double workMs, uint32_t drawnChunks);
+
+    uint32_t renderDistance, minRenderDistance, maxRenderDistance;
+    double targetFrameMs;
+    double smoothedFrameMs = 0.0, smoothedWorkMs = 0.0;
+    double overBudgetTime = 0.0, underBudgetTime = 0.0;
+};
@@ -6,7 +6,19 @@
 #include "Metrics.h"
 #include "Shader.h"
 #include "Texture.h"
-#include "GLFW/glfw3.h"
+#include "UniformBuffer.h"
+#include <span>
+
+// towards the sun, diffuse light in rgb and ambient in w. The shaders get them in the FrameData block,
+// HorizonTerrain bakes the same light into its vertices.
+constexpr glm::vec4 LIGHT_DIRECTION{-1.0f, 2.0f, -1.0f, 0.0f};
+constexpr glm::vec4 LIGHT_COLOR{0.56f, 0.56f, 0.56f, 0.3f};
+
+// instances [first, first + count) of an instanced vertex array
+struct InstanceRange
+{
+    GLuint first, count;
+};
 
 class Renderer
 {
@@ -14,13 +26,29 @@ public:
     Renderer();
     ~Renderer();
 
-    void prepareChunkRendering(const glm::mat4& viewProjection, float exposure);
-    void drawHighlightBlock(const glm::vec3& pos, const glm::mat4& viewProjection, float exposure);
-    void drawChunk(const VertexArray& vao, const glm::ivec3& globalOffset);
+    // fills the per-frame uniform block every shader reads the camera and the light from
+    void beginFrame(const glm::mat4& viewProjection, float exposure);
+    // chunks holds the offset (xyz) and the mesh cell width in blocks (w) of every chunk drawn this frame,
+    // the draws below refer to them by index
+    void prepareChunkRendering(std::span<const glm::vec4> chunks);
+    void drawHighlightBlock(const glm::vec3& pos);
+    void drawChunk(const VertexArray& vao, uint32_t chunkIndex);
+    // only draws the given ranges of the faces
+    void drawChunk(const VertexArray& vao, uint32_t chunkIndex, std::span<const InstanceRange> ranges);
+    // one multi-draw over the tiles in the shared buffer, nothing is drawn between cutoutMin and cutoutMax on x/z
+    void drawHorizon(const VertexArray& vao, const std::vector<GLsizei>& counts, const std::vector<const void*>& indices, const std::vector<GLint>& baseVertices,
+                     const glm::vec3& cutoutMin, const glm::vec3& cutoutMax);
     void clearFrame(float skyExposure) const;
     void drawEntity(const VertexArray& vao, const glm::vec3& pos, const glm::mat4& viewProjection, float exposure);
 private:
-    Shader m_BasicShader, m_BlockShader;
+    void bindChunk(uint32_t chunkIndex);
+
+    Shader m_BasicShader, m_BlockShader, m_HorizonShader;
     VertexArray m_HighlightVao;
     Texture m_TextureAtlas;
+    UniformBuffer m_FrameData, m_ChunkData, m_HighlightData;
+    // batch of m_ChunkData bound to the chunk block, -1 if none or the highlight is bound
+    int32_t m_BoundChunkBatch = -1;
+    // resolved when the shaders are linked
+    GLint m_BasicVPUniform, m_BasicPositionUniform, m_ChunkIndexUniform, m_CutoutMinUniform, m_CutoutMaxUniform;
 };
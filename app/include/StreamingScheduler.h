@@ -0,0 +1,66 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include "Config.h"
+
+enum STREAM_STAGE
+{
+    STREAM_UNLOAD,
+    STREAM_LOAD,
+    STREAM_MESH,
+    STREAM_UPLOAD,
+    STREAM_STAGE_COUNT
+};
+
+constexpr std::array<const char*, STREAM_STAGE_COUNT> STREAM_STAGE_NAMES = {"Unload", "Load", "Mesh", "Upload"};
+
+// Picks per-frame chunk quotas so that streaming fits into what is left of the frame budget after
+// the rest of the update and rendering. Per-item costs are measured online as moving averages.
+struct StreamingScheduler
+{
+    explicit StreamingScheduler(const GameConfig& config);
+
+    // times a stage, func returns the number of items it processed
+    template<typename F>
+    uint32_t run(STREAM_STAGE stage, F&& func);
+    void beginFrame();
+    void endUpdate();
+    void beginRender();
+    void endRender();
+
+    std::array<uint32_t, STREAM_STAGE_COUNT> quotas;
+    std::array<uint32_t, STREAM_STAGE_COUNT> maxQuotas;
+    std::array<double, STREAM_STAGE_COUNT> costPerItemMs{};
+    std::array<double, STREAM_STAGE_COUNT> stageMs{};
+    double frameBudgetMs;
+    double otherWorkMs = 0.0, streamingBudgetMs = 0.0, streamingMs = 0.0;
+    // update and render time of the last frame
+    double frameWorkMs = 0.0;
+private:
+    void updateQuotas();
+
+    std::chrono::steady_clock::time_point m_UpdateStart, m_RenderStart;
+    double m_UpdateMs = 0.0, m_RenderMs = 0.0;
+};
+
+template<typename F>
+uint32_t StreamingScheduler::run(const STREAM_STAGE stage, F&& func)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const uint32_t items = func(quotas[stage]);
+    const std::chrono::duration<double, std::milli> ms = std::chrono::steady_clock::now() - start;
+
+    stageMs[stage] = ms.count();
+    streamingMs += ms.count();
+
+    // a frame without items only tells us about the fixed overhead, keep the last estimate
+    if (items > 0)
+    {
+        constexpr double SMOOTHING = 0.1;
+        const double cost = ms.count() / items;
+        costPerItemMs[stage] = costPerItemMs[stage] == 0.0 ? cost : costPerItemMs[stage] + SMOOTHING * (cost - costPerItemMs[stage]);
+    }
+
+    return items;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "glm/glm.hpp"
+
+const auto TRACE_PATH = "trace.json";
+
+// one chrome trace "complete" event, names and categories are string literals
+struct TraceEvent
+{
+    const char* name;
+    const char* category;
+    int64_t startUs, durationUs;
+    glm::ivec3 chunkPosition;
+    bool hasChunk;
+};
+
+inline std::atomic<bool> traceRecording = false;
+
+inline bool isTraceRecording() { return traceRecording.load(std::memory_order_acquire); }
+void startTraceRecording();
+// stops recording and writes everything captured since the start as chrome trace json (chrome://tracing, ui.perfetto.dev)
+bool stopTraceRecording(const std::string& path);
+void recordTraceEvent(const char* name, const char* category, std::chrono::steady_clock::time_point start,
+                      std::chrono::steady_clock::time_point end, const glm::ivec3* chunkPosition = nullptr);
+
+class ScopedTrace
+{
+public:
+    explicit ScopedTrace(const char* name, const char* category)
+        : m_Name(name), m_Category(category), m_Active(isTraceRecording())
+    {
+        if (m_Active) m_Start = std::chrono::steady_clock::now();
+    }
+    ScopedTrace(const char* name, const char* category, const glm::ivec3& chunkPosition)
+        : ScopedTrace(name, category)
+    {
+        m_ChunkPosition = chunkPosition;
+        m_HasChunk = true;
+    }
+    ~ScopedTrace()
+    {
+        if (m_Active)
+            recordTraceEvent(m_Name, m_Category, m_Start, std::chrono::steady_clock::now(), m_HasChunk ? &m_ChunkPosition : nullptr);
+    }
+private:
+    const char* m_Name;
+    const char* m_Category;
+    bool m_Active;
+    bool m_HasChunk = false;
+    glm::ivec3 m_ChunkPosition{0};
+    std::chrono::steady_clock::time_point m_Start;
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include "Chunk.h"
+#include "GameWorld.h"
+#include <condition_variable>
+#include <optional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <unordered_set>
+
+// Owns all writes to the save game, runs on its own thread and database connection
+struct WorldSaver
+{
+    WorldSaver(const std::string& dbPath, uint32_t compactionThreshold, uint32_t worldSeed);
+    void requestCompaction(const glm::ivec3& chunkPos);
+    void queueSnapshots(std::vector<ChunkSnapshot>&& chunkSnapshots);
+    // Latest queued snapshot of a chunk that is not written yet, the database is behind it
+    std::shared_ptr<const Chunk::BlockStorage> findUnsaved(const glm::ivec3& chunkPos) const;
+
+    std::string dbPath;
+    uint32_t compactionThreshold;
+    WorldGenerationData worldGenData;
+    std::queue<ChunkSnapshot> snapshots;
+    std::unordered_map<glm::ivec3, std::shared_ptr<const Chunk::BlockStorage>> unsavedSnapshots;
+    std::queue<glm::ivec3> compactionRequests;
+    std::unordered_set<glm::ivec3> pendingCompactions;
+    mutable std::mutex queueMutex;
+    std::condition_variable_any queueCondition;
+    std::jthread thread;
+private:
+    void threadLoop(const std::stop_token& st);
+};
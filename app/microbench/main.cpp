@@ -0,0 +1,385 @@
+#include <benchmark/benchmark.h>
+#include <cstmlib/Log.h>
+
+#include "Chunk.h"
+#include "Entity.h"
+#include "HorizonTerrain.h"
+#include "Lighting.h"
+#include "Raycast.h"
+
+// Microbenchmarks of the voxel kernels, diff runs with
+// VoxelGame_microbench --benchmark_format=json --benchmark_out=<file>.json
+
+constexpr uint32_t BENCH_SEED = 1337;
+
+static const GameConfig& benchConfig()
+{
+    static const GameConfig config = []
+    {
+        GameConfig c;
+        c.worldSeed = BENCH_SEED;
+        return c;
+    }();
+    return config;
+}
+
+static const WorldGenerationData& worldGenData()
+{
+    static const WorldGenerationData data(BENCH_SEED);
+    return data;
+}
+
+enum BIOME { OCEAN, VALLEY, PLAINS, MOUNTAINS, MESA, BIOME_COUNT };
+constexpr const char* BIOME_NAMES[] = {"ocean", "valley", "plains", "mountains", "mesa"};
+// biome noise ranges (normalized to [0, 1]) taken from noiseToHeight, without the blend zones
+constexpr float BIOME_RANGES[][2] = {{0.0f, 0.15f}, {0.2f, 0.3f}, {0.35f, 0.65f}, {0.7f, 0.8f}, {0.85f, 0.95f}};
+
+// Returns the surface chunk of the first chunk column whose center lies in the biome
+static glm::ivec3 findBiomeChunk(const BIOME biome)
+{
+    const auto& data = worldGenData();
+    for (int32_t r = 0; r < 512; r++)
+    {
+        for (int32_t x = -r; x <= r; x++)
+        {
+            for (const int32_t z : {-r, r})
+            {
+                const glm::ivec2 center = glm::ivec2{x, z} * Chunk::CHUNK_SIZE + Chunk::CHUNK_SIZE / 2;
+                const float biomeValue = (data.biomeNoise.GetNoise(float(center.x), float(center.y)) + 1.0f) * 0.5f;
+                if (biomeValue < BIOME_RANGES[biome][0] || biomeValue > BIOME_RANGES[biome][1])
+                    continue;
+
+                const int32_t height = glm::max<int32_t>(data.getHeightAt(center), WorldGenerationData::SEA_LEVEL);
+                return {x, height / Chunk::CHUNK_SIZE, z};
+            }
+        }
+    }
+
+    return glm::ivec3{0, WorldGenerationData::SEA_LEVEL / Chunk::CHUNK_SIZE, 0};
+}
+
+// Chunk manager with every chunk within radius of the origin chunk generated
+static ChunkManager& loadedChunkManager()
+{
+    static ChunkManager chunkManager(benchConfig());
+
+    if (chunkManager.chunks.empty())
+    {
+        constexpr int32_t RADIUS = 3;
+        for (int32_t x = -RADIUS; x <= RADIUS; x++)
+            for (int32_t y = 0; y < WorldGenerationData::WORLD_HEIGHT; y++)
+                for (int32_t z = -RADIUS; z <= RADIUS; z++)
+                    chunkManager.chunks.emplace(glm::ivec3{x, y, z}, Chunk(glm::ivec3{x, y, z}, worldGenData()));
+    }
+
+    return chunkManager;
+}
+
+// Chunk manager with every chunk within radius of the origin chunk generated and lit top down like loadChunks does
+static ChunkManager& litChunkManager()
+{
+    static ChunkManager chunkManager(benchConfig());
+
+    if (chunkManager.chunks.empty())
+    {
+        constexpr int32_t RADIUS = 2;
+        constexpr std::array<glm::ivec3, 6> offsets{{{0, 0, -1}, {0, 0, 1}, {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}}};
+        for (int32_t x = -RADIUS; x <= RADIUS; x++)
+            for (int32_t y = 0; y < WorldGenerationData::WORLD_HEIGHT; y++)
+                for (int32_t z = -RADIUS; z <= RADIUS; z++)
+                    chunkManager.chunks.emplace(glm::ivec3{x, y, z}, Chunk(glm::ivec3{x, y, z}, worldGenData()));
+
+        for (int32_t y = WorldGenerationData::WORLD_HEIGHT - 1; y >= 0; y--)
+        {
+            for (int32_t x = -RADIUS; x <= RADIUS; x++)
+            {
+                for (int32_t z = -RADIUS; z <= RADIUS; z++)
+                {
+                    Chunk& chunk = *chunkManager.getChunk({x, y, z});
+                    std::array<const Chunk::LightStorage*, 6> neighbourLight{};
+                    for (uint32_t face = 0; face < 6; face++)
+                        if (const Chunk* neighbour = chunkManager.getChunk(chunk.chunkPosition + offsets[face]); neighbour && neighbour->isLit)
+                            neighbourLight[face] = &neighbour->light;
+
+                    Chunk::LightStorage light;
+                    fillChunkLight(*chunk.blocks, neighbourLight, true, light);
+                    chunkManager.setChunkLight(chunk, std::move(light));
+                }
+            }
+        }
+        chunkManager.meshQueue.clear();
+        chunkManager.lightQueue.clear();
+    }
+
+    return chunkManager;
+}
+
+static std::array<Chunk*, 6> getNeighbours(ChunkManager& chunkManager, const glm::ivec3& pos)
+{
+    return {
+        // BACK, FRONT, LEFT, RIGHT, BOTTOM, TOP
+        chunkManager.getChunk(pos + glm::ivec3{0, 0, -1}),
+        chunkManager.getChunk(pos + glm::ivec3{0, 0, 1}),
+        chunkManager.getChunk(pos + glm::ivec3{-1, 0, 0}),
+        chunkManager.getChunk(pos + glm::ivec3{1, 0, 0}),
+        chunkManager.getChunk(pos + glm::ivec3{0, -1, 0}),
+        chunkManager.getChunk(pos + glm::ivec3{0, 1, 0})
+    };
+}
+
+static void BM_ChunkGeneration(benchmark::State& state)
+{
+    const auto biome = BIOME(state.range(0));
+    const glm::ivec3 pos = findBiomeChunk(biome);
+    state.SetLabel(BIOME_NAMES[biome]);
+
+    for (auto _ : state)
+    {
+        Chunk chunk(pos, worldGenData());
+        benchmark::DoNotOptimize(chunk.blocks);
+    }
+
+    state.SetItemsProcessed(state.iterations() * Chunk::BLOCKS_PER_CHUNK);
+}
+BENCHMARK(BM_ChunkGeneration)->DenseRange(OCEAN, MESA)->Unit(benchmark::kMicrosecond);
+
+static void BM_GenerateMeshData(benchmark::State& state)
+{
+    const bool withNeighbours = state.range(0) != 0;
+    ChunkManager& chunkManager = loadedChunkManager();
+    const glm::ivec3 pos{0, WorldGenerationData::SEA_LEVEL / Chunk::CHUNK_SIZE, 0};
+    Chunk& chunk = *chunkManager.getChunk(pos);
+
+    const std::array<Chunk*, 6> noNeighbours{};
+    const std::array<Chunk*, 6> neighbours = withNeighbours ? getNeighbours(chunkManager, pos) : noNeighbours;
+    std::array<Chunk*, 20> diagonals{};
+    for (uint32_t i = 0; i < diagonals.size() && withNeighbours; i++)
+        diagonals[i] = chunkManager.getChunk(pos + DIAGONAL_OFFSETS[i]);
+    state.SetLabel(withNeighbours ? "with neighbours" : "without neighbours");
+
+    size_t faces = 0;
+    for (auto _ : state)
+    {
+        chunk.generateMeshData(neighbours, diagonals);
+        faces += chunk.meshDataOpaque.size() + chunk.meshDataTranslucent.size();
+    }
+
+    state.SetItemsProcessed(state.iterations() * Chunk::BLOCKS_PER_CHUNK);
+    state.counters["faces"] = benchmark::Counter(double(faces), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_GenerateMeshData)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+static void BM_FillChunkLight(benchmark::State& state)
+{
+    const auto biome = BIOME(state.range(0));
+    const Chunk chunk(findBiomeChunk(biome), worldGenData());
+    state.SetLabel(BIOME_NAMES[biome]);
+
+    Chunk::LightStorage light;
+    for (auto _ : state)
+    {
+        fillChunkLight(*chunk.blocks, {}, true, light);
+        benchmark::DoNotOptimize(light.voxels);
+    }
+
+    state.SetItemsProcessed(state.iterations() * Chunk::BLOCKS_PER_CHUNK);
+}
+BENCHMARK(BM_FillChunkLight)->Arg(PLAINS)->Arg(MOUNTAINS)->Unit(benchmark::kMicrosecond);
+
+// Places and removes a lamp on the surface in the middle of the lit area, both relight incrementally
+static void BM_RelightEdit(benchmark::State& state)
+{
+    ChunkManager& chunkManager = litChunkManager();
+    const glm::ivec2 column{Chunk::CHUNK_SIZE / 2};
+    // the first block above the terrain or the sea
+    const int32_t surfaceY = glm::max(int32_t(worldGenData().getHeightAt(column)), int32_t(WorldGenerationData::SEA_LEVEL) + 1);
+    const glm::ivec3 worldPos{column.x, surfaceY, column.y};
+    Chunk& chunk = *chunkManager.getChunk(worldPosToChunkPos(worldPos));
+    const glm::ivec3 positionInChunk = worldPosToChunkBlockPos(worldPos);
+    const BLOCK_TYPE original = chunk.getBlockUnsafe(positionInChunk);
+
+    uint64_t relitVoxels = 0;
+    for (auto _ : state)
+    {
+        chunkManager.setBlock(chunk, positionInChunk, BLOCK_TYPE::LAMP);
+        relitVoxels += chunkManager.lastRelitVoxels;
+        chunkManager.setBlock(chunk, positionInChunk, original);
+        relitVoxels += chunkManager.lastRelitVoxels;
+        // the remeshes the edits queue are never run here
+        chunkManager.meshQueue.clear();
+    }
+
+    state.SetItemsProcessed(state.iterations() * 2);
+    state.counters["voxels"] = benchmark::Counter(double(relitVoxels), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_RelightEdit)->Unit(benchmark::kMicrosecond);
+
+static void BM_GenerateLodMeshData(benchmark::State& state)
+{
+    const auto lod = uint32_t(state.range(0));
+    ChunkManager& chunkManager = loadedChunkManager();
+    const glm::ivec3 pos{0, WorldGenerationData::SEA_LEVEL / Chunk::CHUNK_SIZE, 0};
+    const Chunk& chunk = *chunkManager.getChunk(pos);
+
+    std::array<const Chunk::BlockStorage*, 6> neighbours{};
+    const std::array<Chunk*, 6> neighbourChunks = getNeighbours(chunkManager, pos);
+    for (uint32_t face = 0; face < 6; face++)
+        neighbours[face] = neighbourChunks[face] ? neighbourChunks[face]->blocks.get() : nullptr;
+    state.SetLabel(std::to_string(1 << lod) + "x");
+
+    Chunk::MeshData opaque, translucent;
+    Chunk::FaceCounts faceCounts;
+    size_t faces = 0;
+    for (auto _ : state)
+    {
+        generateLodMeshData(*chunk.blocks, neighbours, lod, opaque, translucent, faceCounts);
+        faces += opaque.size() + translucent.size();
+    }
+
+    state.SetItemsProcessed(state.iterations() * Chunk::BLOCKS_PER_CHUNK);
+    state.counters["faces"] = benchmark::Counter(double(faces), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_GenerateLodMeshData)->Arg(1)->Arg(2)->Unit(benchmark::kMicrosecond);
+
+static void BM_GenerateHorizonTile(benchmark::State& state)
+{
+    std::vector<HorizonVertex> vertices;
+    int32_t i = 0;
+    for (auto _ : state)
+    {
+        generateHorizonTile(worldGenData(), glm::ivec2{i % 16, i / 16 % 16}, vertices);
+        benchmark::DoNotOptimize(vertices.data());
+        i++;
+    }
+
+    state.SetItemsProcessed(state.iterations() * HorizonTerrain::TILE_VERTICES);
+}
+BENCHMARK(BM_GenerateHorizonTile)->Unit(benchmark::kMicrosecond);
+
+static void BM_PackBlockData(benchmark::State& state)
+{
+    uint32_t i = 0;
+    for (auto _ : state)
+    {
+        const glm::uvec3 pos{i & 31, (i >> 5) & 31, (i >> 10) & 31};
+        benchmark::DoNotOptimize(packBlockData(pos, glm::uvec2{i & 15, (i >> 4) & 15}, FACE(i % 6), uint8_t(i), uint8_t(i >> 8)));
+        i++;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PackBlockData);
+
+static void BM_NoiseToHeight(benchmark::State& state)
+{
+    float value = -1.0f;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(noiseToHeight(value, -value, value * 0.5f));
+        value += 0.0001f;
+        if (value > 1.0f) value = -1.0f;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_NoiseToHeight);
+
+static void BM_Raycast(benchmark::State& state)
+{
+    const auto reach = float(state.range(0));
+    ChunkManager& chunkManager = loadedChunkManager();
+    const glm::vec3 origin{0.5f, float(WorldGenerationData::MAX_HEIGHT) * 0.5f, 0.5f};
+
+    uint32_t i = 0;
+    for (auto _ : state)
+    {
+        const float angle = float(i++ % 64) / 64.0f * 6.2831853f;
+        const glm::vec3 dir = glm::normalize(glm::vec3{glm::cos(angle), -0.3f, glm::sin(angle)});
+        benchmark::DoNotOptimize(raycast(origin, dir, reach, chunkManager));
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Raycast)->Arg(4)->Arg(16)->Arg(64)->Arg(128);
+
+static void BM_ApplyVelocityAndHandleCollisions(benchmark::State& state)
+{
+    ChunkManager& chunkManager = loadedChunkManager();
+    const int32_t groundHeight = glm::max<int32_t>(worldGenData().getHeightAt({4, 4}), WorldGenerationData::SEA_LEVEL);
+    const PhysicsObject start{BoundingBox{glm::vec3{4.0f, float(groundHeight + 4), 4.0f}, glm::vec3{1.0f, 2.0f, 1.0f}}, glm::vec3{0.3f, -0.5f, 0.2f}};
+
+    PhysicsObject obj = start;
+    for (auto _ : state)
+    {
+        // reset every few steps so the box keeps colliding with the ground near the start
+        if (obj.box.pos.y < float(groundHeight - 8) || glm::abs(obj.box.pos.x - start.box.pos.x) > 16.0f)
+            obj = start;
+        benchmark::DoNotOptimize(applyVelocityAndHandleCollisions(chunkManager, obj));
+        applyGravity(obj, 1.0f / 60.0f);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ApplyVelocityAndHandleCollisions);
+
+static void BM_GetChunk(benchmark::State& state)
+{
+    const auto radius = int32_t(state.range(0));
+    ChunkManager chunkManager(benchConfig());
+    for (int32_t x = -radius; x <= radius; x++)
+    {
+        for (int32_t y = 0; y < WorldGenerationData::WORLD_HEIGHT; y++)
+        {
+            for (int32_t z = -radius; z <= radius; z++)
+            {
+                // lookups never touch the blocks, skip the storage to keep large maps cheap
+                Chunk& chunk = chunkManager.chunks.emplace(glm::ivec3{x, y, z}, Chunk()).first->second;
+                chunk.blocks.reset();
+            }
+        }
+    }
+
+    uint32_t i = 0;
+    for (auto _ : state)
+    {
+        // half of the lookups miss just outside the loaded area
+        const glm::ivec3 pos{int32_t(i % (2 * radius + 3)) - radius - 1, int32_t(i % WorldGenerationData::WORLD_HEIGHT), int32_t((i / 7) % (2 * radius + 1)) - radius};
+        benchmark::DoNotOptimize(chunkManager.getChunk(pos));
+        i++;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["chunks"] = double(chunkManager.chunks.size());
+}
+BENCHMARK(BM_GetChunk)->RangeMultiplier(2)->Range(2, 32);
+
+static void BM_ThreadPoolQueueJob(benchmark::State& state)
+{
+    const auto jobs = uint32_t(state.range(0));
+    ThreadPool threadPool(benchConfig().threadCount);
+    std::atomic<uint32_t> counter = 0;
+
+    for (auto _ : state)
+    {
+        for (uint32_t i = 0; i < jobs; i++)
+            threadPool.queueJob([&counter] { counter.fetch_add(1, std::memory_order_relaxed); });
+
+        while (threadPool.busy())
+            std::this_thread::yield();
+    }
+
+    state.SetItemsProcessed(state.iterations() * jobs);
+}
+BENCHMARK(BM_ThreadPoolQueueJob)->Arg(64)->Arg(1024)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+int main(int argc, char** argv)
+{
+    LOG_INIT();
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -1,12 +1,27 @@
 #version 330 core
 
 const float s_atlasSize = 16.0f; // 16x16 texture atlas
+// light kept per level of sky or block light below the maximum, and what is left in complete darkness
+const float s_lightFalloff = 0.8f;
+const float s_minLight = 0.02f;
+const vec3 s_blockLightColor = vec3(1.0f, 0.8f, 0.55f);
 
 in vec2 v_uv;
 in vec3 v_normal;
+in vec2 v_light;
+in float v_occlusion;
 
 uniform sampler2D u_textureSlot;
-uniform vec3 u_exposure;
+// per frame, filled once by Renderer::beginFrame and shared by every shader
+layout(std140) uniform FrameData
+{
+    mat4 u_VP;
+    vec4 u_exposure;
+    // xyz towards the light
+    vec4 u_lightDirection;
+    // diffuse light in rgb, ambient in w
+    vec4 u_lightColor;
+};
 
 layout(location = 0) out vec4 out_color;
 
@@ -19,20 +34,22 @@ void main()
     vec4 modelColor = getTextureColor(v_uv, u_textureSlot);
     modelColor.rgb = pow(modelColor.rgb, vec3(2.2));
 
-    // lighting
-    vec3 lightColor = vec3(0.8);
+    // lighting, the sun and the sky only reach as far as the sky light does
+    vec3 lighting = vec3(u_lightColor.w); // add ambient
 
-    vec3 lightSource = vec3(-1.0, 2.0, -1.0);
-    vec3 lighting = vec3(0.3); // add ambient
+    float diffuseStrength = max(0.0, dot(u_lightDirection.xyz, v_normal));
+    lighting += diffuseStrength * u_lightColor.rgb; // add diffuse
+    lighting *= pow(s_lightFalloff, (1.0 - v_light.x) * 15.0);
 
-    float diffuseStrength = max(0.0, dot(lightSource, v_normal));
-    lighting += diffuseStrength * lightColor * 0.7; // add diffuse
+    // block light falls off the same way per block and is never fully dark next to a source
+    lighting += s_blockLightColor * (v_light.y > 0.0 ? pow(s_lightFalloff, (1.0 - v_light.y) * 15.0) : 0.0);
+    lighting = max(lighting * v_occlusion, vec3(s_minLight));
 
     modelColor.rgb *= lighting;
     vec4 color = modelColor;
 
     // tonemapping
-    color.rgb = unchartedTonemapping(color.rgb * u_exposure);
+    color.rgb = unchartedTonemapping(color.rgb * u_exposure.rgb);
     color.rgb = pow(color.rgb, vec3(1/2.2));
 
     out_color = color;
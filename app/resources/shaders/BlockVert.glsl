@@ -1,6 +1,7 @@
 #version 330 core
 
-layout (location = 0) in uint in_packedData;
+// position, texture and direction in x, the light in front of the face and the occlusion of its corners in y
+layout (location = 0) in uvec2 in_packedData;
 
 const uint s_faceMask = 0xFu, s_faceOffset = 28u;
 const uint s_xPosMask = 0x1Fu, s_xPosOffset = 23u;
@@ -8,55 +9,55 @@ const uint s_yPosMask = 0x1Fu, s_yPosOffset = 18u;
 const uint s_zPosMask = 0x1Fu, s_zPosOffset = 13u;
 const uint s_atlasXMask = 0xFu, s_atlasXOffset = 9u;
 const uint s_atlasYMask = 0xFu, s_atlasYOffset = 5u;
+const uint s_skyLightMask = 0xFu, s_blockLightOffset = 4u;
+const uint s_occlusionOffset = 8u, s_cornerMask = 0x3u;
+const float s_maxLight = 15.0f;
 
-uniform mat4 u_VP;
-uniform vec3 u_chunkOffset;
+// per frame, filled once by Renderer::beginFrame and shared by every shader
+layout(std140) uniform FrameData
+{
+    mat4 u_VP;
+    vec4 u_exposure;
+    // xyz towards the light
+    vec4 u_lightDirection;
+    // diffuse light in rgb, ambient in w
+    vec4 u_lightColor;
+};
+
+const int s_chunksPerBatch = 1024;
+// world offset of the chunks drawn this frame in xyz, the width of a mesh cell in blocks in w
+// (1 except for level of detail meshes), bound a batch at a time
+layout(std140) uniform ChunkData
+{
+    vec4 u_chunks[s_chunksPerBatch];
+};
+// index of the drawn chunk in the bound batch
+uniform int u_chunkIndex;
 
 out vec2 v_uv;
 out vec3 v_normal;
+// sky and block light, 0 to 1
+out vec2 v_light;
+// light left at the corners by the blocks around them, interpolated over the face
+out float v_occlusion;
+
+// per corner occlusion value from fully occluded to open
+const float s_occlusionCurve[4] = float[4](0.45f, 0.65f, 0.82f, 1.0f);
+
+// the 4 corners of each face, the same order Chunk.cpp bakes their occlusion in
+const vec3 s_cornerPositions[24] = vec3[24](
+    vec3(0.0f, 0.0f, 0.0f), vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 1.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), // back
+    vec3(0.0f, 0.0f, 1.0f), vec3(0.0f, 1.0f, 1.0f), vec3(1.0f, 1.0f, 1.0f), vec3(1.0f, 0.0f, 1.0f), // front
+    vec3(0.0f, 0.0f, 1.0f), vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f), vec3(0.0f, 1.0f, 1.0f), // left
+    vec3(1.0f, 0.0f, 0.0f), vec3(1.0f, 0.0f, 1.0f), vec3(1.0f, 1.0f, 1.0f), vec3(1.0f, 1.0f, 0.0f), // right
+    vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 1.0f), vec3(1.0f, 0.0f, 1.0f), vec3(1.0f, 0.0f, 0.0f), // bottom
+    vec3(0.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 0.0f), vec3(1.0f, 1.0f, 1.0f), vec3(0.0f, 1.0f, 1.0f)  // top
+);
 
-const vec3 s_vertexPositions[36] = vec3[36](
-    vec3(0.0f, 0.0f, 0.0f),// 0, back
-    vec3(1.0f, 0.0f, 0.0f),// 1, back
-    vec3(1.0f, 1.0f, 0.0f), // 2, back
-    vec3(1.0f, 1.0f, 0.0f),  // 3, back
-    vec3(0.0f, 1.0f, 0.0f),  // 4, back
-    vec3(0.0f, 0.0f, 0.0f),  // 5, back
-
-    vec3(0.0f, 0.0f, 1.0f), // 0, front
-    vec3(0.0f, 1.0f, 1.0f), // 1, front
-    vec3(1.0f, 1.0f, 1.0f), // 2, front
-    vec3(1.0f, 1.0f, 1.0f), // 3, front
-    vec3(1.0f, 0.0f, 1.0f), // 4, front
-    vec3(0.0f, 0.0f, 1.0f), // 5, front
-
-    vec3(0.0f, 0.0f, 1.0f), // 0, left
-    vec3(0.0f, 0.0f, 0.0f), // 1, left
-    vec3(0.0f, 1.0f, 0.0f), // 2, left
-    vec3(0.0f, 1.0f, 0.0f), // 3, left
-    vec3(0.0f, 1.0f, 1.0f), // 4, left
-    vec3(0.0f, 0.0f, 1.0f), // 5, left
-
-    vec3(1.0f, 0.0f, 0.0f), // 0, right
-    vec3(1.0f, 0.0f, 1.0f), // 1, right
-    vec3(1.0f, 1.0f, 1.0f), // 2, right
-    vec3(1.0f, 1.0f, 1.0f), // 3, right
-    vec3(1.0f, 1.0f, 0.0f), // 4, right
-    vec3(1.0f, 0.0f, 0.0f), // 5, right
-
-    vec3(0.0f, 0.0f, 0.0f), // 0, bottom
-    vec3(0.0f, 0.0f, 1.0f), // 1, bottom
-    vec3(1.0f, 0.0f, 1.0f), // 2, bottom
-    vec3(1.0f, 0.0f, 1.0f), // 3, bottom
-    vec3(1.0f, 0.0f, 0.0f), // 4, bottom
-    vec3(0.0f, 0.0f, 0.0f), // 5, bottom
-
-    vec3(0.0f, 1.0f, 0.0f), // 0, top
-    vec3(1.0f, 1.0f, 0.0f), // 1, top
-    vec3(1.0f, 1.0f, 1.0f), // 2, top
-    vec3(1.0f, 1.0f, 1.0f), // 3, top
-    vec3(0.0f, 1.0f, 1.0f), // 4, top
-    vec3(0.0f, 1.0f, 0.0f)  // 5, top
+// two triangles over corners 0-2 or, flipped, over corners 1-3
+const uint s_quadCorners[12] = uint[12](
+    0u, 1u, 2u, 2u, 3u, 0u,
+    1u, 2u, 3u, 3u, 0u, 1u
 );
 
 const uint s_frontIndex = 0u;
@@ -77,18 +78,25 @@ const vec3 s_normals[6] = vec3[6](
 
 void main()
 {
-    vec3 translation = u_chunkOffset;
-
-    translation.x += float((in_packedData >> s_xPosOffset) & s_xPosMask);
-    translation.y += float((in_packedData >> s_yPosOffset) & s_yPosMask);
-    translation.z += float((in_packedData >> s_zPosOffset) & s_zPosMask);
-
-    uint faceIndex = (in_packedData >> s_faceOffset) & s_faceMask;
-    uint vertexIndex = faceIndex * 6u + uint(gl_VertexID) % 6u;
-    vec3 vertexPos = s_vertexPositions[vertexIndex];
-    gl_Position = u_VP * vec4(vertexPos + translation, 1.0f);
+    uint geometry = in_packedData.x;
+    vec3 translation;
+    translation.x = float((geometry >> s_xPosOffset) & s_xPosMask);
+    translation.y = float((geometry >> s_yPosOffset) & s_yPosMask);
+    translation.z = float((geometry >> s_zPosOffset) & s_zPosMask);
+
+    uint faceIndex = (geometry >> s_faceOffset) & s_faceMask;
+    uint occlusion = in_packedData.y >> s_occlusionOffset;
+    uvec4 cornerOcclusion = (uvec4(occlusion) >> uvec4(0u, 2u, 4u, 6u)) & s_cornerMask;
+    // the diagonal joins the brighter pair of corners, so a single dark corner doesn't smear along it
+    bool flipped = cornerOcclusion.x + cornerOcclusion.z < cornerOcclusion.y + cornerOcclusion.w;
+    uint corner = s_quadCorners[(flipped ? 6u : 0u) + uint(gl_VertexID) % 6u];
+    vec3 vertexPos = s_cornerPositions[faceIndex * 4u + corner];
+    v_occlusion = s_occlusionCurve[cornerOcclusion[corner]];
+    vec4 chunk = u_chunks[u_chunkIndex];
+    gl_Position = u_VP * vec4(chunk.xyz + (vertexPos + translation) * chunk.w, 1.0f);
 
     v_normal = s_normals[faceIndex];
+    v_light = vec2(float(in_packedData.y & s_skyLightMask), float((in_packedData.y >> s_blockLightOffset) & s_skyLightMask)) / s_maxLight;
 
     uvec2 uvOffset;
     if (faceIndex == s_frontIndex || faceIndex == s_backIndex)
@@ -99,7 +107,7 @@ void main()
         uvOffset = uvec2(vertexPos.z == 1.0f ? 0 : 1, vertexPos.x == 1.0f ? 0 : 1);
 
     v_uv = vec2(
-        float(((in_packedData >> s_atlasXOffset) & s_atlasXMask) + uvOffset.x),
-        float(((in_packedData >> s_atlasYOffset) & s_atlasYMask) + uvOffset.y)
+        float(((geometry >> s_atlasXOffset) & s_atlasXMask) + uvOffset.x),
+        float(((geometry >> s_atlasYOffset) & s_atlasYMask) + uvOffset.y)
     );
 }
\ No newline at end of file
@@ -0,0 +1,58 @@
+#version 330 core
+
+in vec3 v_worldPos;
+in vec3 v_color;
+in float v_lighting;
+
+// per frame, filled once by Renderer::beginFrame and shared by every shader
+layout(std140) uniform FrameData
+{
+    mat4 u_VP;
+    vec4 u_exposure;
+    // xyz towards the light
+    vec4 u_lightDirection;
+    // diffuse light in rgb, ambient in w
+    vec4 u_lightColor;
+};
+// the chunks are drawn in here
+uniform vec3 u_cutoutMin;
+uniform vec3 u_cutoutMax;
+
+layout(location = 0) out vec4 out_color;
+
+vec3 Uncharted2Tonemap(vec3 x);
+vec3 unchartedTonemapping(vec3 color);
+
+void main()
+{
+    if (all(greaterThanEqual(v_worldPos.xz, u_cutoutMin.xz)) && all(lessThan(v_worldPos.xz, u_cutoutMax.xz)))
+        discard;
+
+    vec3 color = pow(v_color, vec3(2.2)) * v_lighting;
+
+    // tonemapping, same as the blocks
+    color = unchartedTonemapping(color * u_exposure.rgb);
+    color = pow(color, vec3(1/2.2));
+
+    out_color = vec4(color, 1.0);
+}
+
+vec3 Uncharted2Tonemap(vec3 x)
+{
+    float Brightness = 0.28;
+    x*= Brightness;
+    float A = 0.28;
+    float B = 0.29;
+    float C = 0.10;
+    float D = 0.2;
+    float E = 0.025;
+    float F = 0.35;
+    return ((x*(A*x+C*B)+D*E)/(x*(A*x+B)+D*F))-E/F;
+}
+
+vec3 unchartedTonemapping(vec3 color)
+{
+    vec3 curr = Uncharted2Tonemap(color*4.7);
+    color = curr/Uncharted2Tonemap(vec3(15.2));
+    return color;
+}
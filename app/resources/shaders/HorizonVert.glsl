@@ -0,0 +1,28 @@
+#version 330 core
+
+layout (location = 0) in vec3 in_position;
+layout (location = 1) in uint in_color;
+
+// per frame, filled once by Renderer::beginFrame and shared by every shader
+layout(std140) uniform FrameData
+{
+    mat4 u_VP;
+    vec4 u_exposure;
+    // xyz towards the light
+    vec4 u_lightDirection;
+    // diffuse light in rgb, ambient in w
+    vec4 u_lightColor;
+};
+
+out vec3 v_worldPos;
+out vec3 v_color;
+out float v_lighting;
+
+void main()
+{
+    gl_Position = u_VP * vec4(in_position, 1.0f);
+    v_worldPos = in_position;
+
+    v_color = vec3(float(in_color & 0xFFu), float((in_color >> 8u) & 0xFFu), float((in_color >> 16u) & 0xFFu)) / 255.0f;
+    v_lighting = float(in_color >> 24u) / 255.0f * 2.0f;
+}
@@ -1,21 +1,47 @@
 #include "Block.h"
 
-blockdata packBlockData(const glm::uvec3& positionInChunk, const glm::uvec2& atlasOffset, const FACE face)
-{
-    constexpr uint32_t
-        FACE_MASK = 0xFu, FACE_OFFSET = 28u,
-        XPOS_MASK = 0x1Fu, XPOS_OFFSET = 23u,
-        YPOS_MASK = 0x1Fu, YPOS_OFFSET = 18u,
-        ZPOS_MASK = 0x1Fu, ZPOS_OFFSET = 13u,
-        ATLASX_MASK = 0xFu, ATLASX_OFFSET = 9u,
-        ATLASY_MASK = 0xFu, ATLASY_OFFSET = 5u;
+constexpr uint32_t
+    FACE_MASK = 0xFu, FACE_OFFSET = 28u,
+    XPOS_MASK = 0x1Fu, XPOS_OFFSET = 23u,
+    YPOS_MASK = 0x1Fu, YPOS_OFFSET = 18u,
+    ZPOS_MASK = 0x1Fu, ZPOS_OFFSET = 13u,
+    ATLASX_MASK = 0xFu, ATLASX_OFFSET = 9u,
+    ATLASY_MASK = 0xFu, ATLASY_OFFSET = 5u;
+
+constexpr uint32_t LIGHT_OFFSET = 32u, OCCLUSION_OFFSET = 40u;
 
-    return  ((face & FACE_MASK) << FACE_OFFSET) |
+blockdata packBlockData(const glm::uvec3& positionInChunk, const glm::uvec2& atlasOffset, const FACE face, const uint8_t light,
+                        const uint8_t occlusion)
+{
+    const uint32_t geometry =
+            ((face & FACE_MASK) << FACE_OFFSET) |
             ((positionInChunk.x & XPOS_MASK) << XPOS_OFFSET) |
             ((positionInChunk.y & YPOS_MASK) << YPOS_OFFSET) |
             ((positionInChunk.z & ZPOS_MASK) << ZPOS_OFFSET) |
             ((atlasOffset.x & ATLASX_MASK) << ATLASX_OFFSET) |
             ((atlasOffset.y & ATLASY_MASK) << ATLASY_OFFSET);
+    return blockdata(occlusion) << OCCLUSION_OFFSET | blockdata(light) << LIGHT_OFFSET | geometry;
+}
+
+glm::uvec3 unpackBlockPosition(const blockdata data)
+{
+    const auto geometry = uint32_t(data);
+    return {(geometry >> XPOS_OFFSET) & XPOS_MASK, (geometry >> YPOS_OFFSET) & YPOS_MASK, (geometry >> ZPOS_OFFSET) & ZPOS_MASK};
+}
+
+FACE unpackBlockFace(const blockdata data)
+{
+    return FACE((uint32_t(data) >> FACE_OFFSET) & FACE_MASK);
+}
+
+uint8_t unpackBlockLight(const blockdata data)
+{
+    return uint8_t(data >> LIGHT_OFFSET);
+}
+
+uint8_t unpackBlockOcclusion(const blockdata data)
+{
+    return uint8_t(data >> OCCLUSION_OFFSET);
 }
 
 glm::uvec2 getAtlasOffset(const BLOCK_TYPE block, const FACE face)
@@ -44,6 +70,8 @@ glm::uvec2 getAtlasOffset(const BLOCK_TYPE block, const FACE face)
         return {15,0};
     case BLOCK_TYPE::WATER:
         return {0+face,15};
+    case BLOCK_TYPE::LAMP:
+        return {0+face,5};
     default:
         LOG_ERROR("Invalid block type for atlas offset");
         exit(1);
@@ -59,3 +87,22 @@ bool isSolid(const BLOCK_TYPE block)
 {
     return block != BLOCK_TYPE::AIR && block != BLOCK_TYPE::WATER;
 }
+
+uint8_t getLightEmission(const BLOCK_TYPE block)
+{
+    return block == BLOCK_TYPE::LAMP ? 14 : 0;
+}
+
+uint8_t getLightOpacity(const BLOCK_TYPE block)
+{
+    switch (block)
+    {
+    case BLOCK_TYPE::AIR:
+        return 0;
+    case BLOCK_TYPE::WATER:
+    case BLOCK_TYPE::LEAVES:
+        return 1;
+    default:
+        return MAX_LIGHT;
+    }
+}
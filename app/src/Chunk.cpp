@@ -6,178 +6,1172 @@
 #include "../include/Rendering.h"
 #include "Shader.h"
 #include "GameWorld.h"
+#include "Lighting.h"
+#include "WorldSaver.h"
 #include "cstmlib/Profiling.h"
 #include "glm/common.hpp"
+#include "Metrics.h"
+#include "MeshCache.h"
+#include "MeshUploader.h"
+#include <algorithm>
+#include <optional>
+
+template<typename... Args>
+static std::shared_ptr<Chunk::BlockStorage> makeBlockStorage(Args&&... args)
+{
+    return std::allocate_shared<Chunk::BlockStorage>(TrackingAllocator<Chunk::BlockStorage, VOXEL_STORAGE>(), std::forward<Args>(args)...);
+}
 
 ChunkManager::ChunkManager(const GameConfig& config)
-    : threadPool(config.threadCount), config(config), worldGenData(config.worldSeed)
+    : threadPool(config.threadCount), config(config), worldGenData(config.worldSeed), renderDistance(config.renderDistance)
 {
     chunks.reserve((2 * config.loadDistance) * (2 * config.loadDistance) * (WorldGenerationData::WORLD_HEIGHT));
+    if (config.meshCacheMB > 0)
+        meshCache = std::make_unique<MeshCache>(size_t(config.meshCacheMB) * 1024 * 1024, config.meshCacheFile, size_t(config.meshCacheFileMB) * 1024 * 1024);
+    lightEngine = std::make_unique<LightEngine>(chunks);
 }
 
-void ChunkManager::unloadChunks(const glm::ivec3& currChunkPos)
+ChunkManager::~ChunkManager()
 {
-    uint32_t unloads = 0;
-    for (auto it = chunks.begin(); it != chunks.end();)
+    for (auto& [_, job] : pendingLoads)
+        job.token->store(true);
+    for (auto& [_, job] : pendingMeshes)
+        job.token->store(true);
+    for (auto& [_, job] : pendingLights)
+        job.token->store(true);
+
+    // join before the result vectors the jobs write into are destroyed
+    threadPool.stop();
+    threadPool.threads.clear();
+
+    for (const auto& mesh : uploadedMeshes)
+        deleteUploadedMesh(mesh);
+}
+
+bool ChunkManager::startUploadThread(SharedContext&& context)
+{
+    if (!context)
     {
-        Chunk& chunk = it->second;
+        LOG_WARN("Could not create a shared GL context, meshes are uploaded on the render thread");
+        return false;
+    }
+
+    meshUploader = std::make_unique<MeshUploader>(std::move(context));
+    return true;
+}
+
+// queued jobs hold a token each, in-flight work stays bounded so cancellation and priorities stay current
+constexpr uint32_t MAX_PENDING_JOBS_PER_THREAD = 4;
+// chunks are only unloaded (and their jobs cancelled) this many chunks past where they are loaded,
+// so walking back and forth over a chunk border does not reload the same shell every time
+constexpr int32_t UNLOAD_HYSTERESIS = 1;
+// BACK, FRONT, LEFT, RIGHT, BOTTOM, TOP, the order the mesher takes its neighbours in
+constexpr std::array<glm::ivec3, 6> NEIGHBOUR_OFFSETS{{{0, 0, -1}, {0, 0, 1}, {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}}};
+
+// chunks above and below the world are never generated, meshing doesn't wait for them
+static bool isInWorld(const glm::ivec3& chunkPos)
+{
+    return chunkPos.y >= 0 && chunkPos.y < int32_t(WorldGenerationData::WORLD_HEIGHT);
+}
 
-        const int32_t xDist = glm::abs(chunk.chunkPosition.x - currChunkPos.x);
-        const int32_t yDist = glm::abs(chunk.chunkPosition.y - currChunkPos.y);
-        const int32_t zDist = glm::abs(chunk.chunkPosition.z - currChunkPos.z);
+// whether the block at pos lies on the side, edge or corner that the neighbour at offset touches
+static bool isTouchingBlock(const glm::ivec3& offset, const glm::ivec3& pos)
+{
+    for (int32_t axis = 0; axis < 3; axis++)
+        if ((offset[axis] < 0 && pos[axis] != 0) || (offset[axis] > 0 && pos[axis] != Chunk::CHUNK_SIZE - 1))
+            return false;
+    return true;
+}
+
+// whether any of the blocks the neighbour at offset touches shades its corners
+static bool hasOccluderTouching(const Chunk::BlockStorage& blocks, const glm::ivec3& offset)
+{
+    constexpr int32_t SIZE = Chunk::CHUNK_SIZE;
+    bool occludes = false;
+    forEachTouchingBlock(-offset, [&](const glm::ivec3& pos)
+    {
+        const BLOCK_TYPE block = blocks[pos.x + pos.y * SIZE + pos.z * SIZE * SIZE];
+        occludes |= block != BLOCK_TYPE::AIR && !isTranslucent(block);
+    });
+    return occludes;
+}
+
+static bool isOutsideRadius(const glm::ivec3& chunkPos, const glm::ivec3& currChunkPos, const int32_t radius)
+{
+    const glm::ivec3 dist = glm::abs(chunkPos - currChunkPos);
+    return dist.x > radius || dist.y > radius || dist.z > radius;
+}
 
-        if (unloads < config.maxUnloadsPerFrame &&
-            !chunk.inRender &&
-            (xDist > config.loadDistance || yDist > config.loadDistance || zDist > config.loadDistance))
+// Calls func for every chunk position in the cube around center that is not in the cube around
+// excludedCenter, a negative excludedRadius excludes nothing. Only walks the shell between both cubes.
+template<typename F>
+static void forEachInCubeDifference(const glm::ivec3& center, const int32_t radius, const glm::ivec3& excludedCenter, const int32_t excludedRadius, F&& func)
+{
+    const glm::ivec3 excludedMin = excludedCenter - excludedRadius, excludedMax = excludedCenter + excludedRadius;
+    for (int32_t x = center.x - radius; x <= center.x + radius; x++)
+    {
+        const bool xOutside = x < excludedMin.x || x > excludedMax.x;
+        for (int32_t y = glm::max(0, center.y - radius); y <= glm::min(int32_t(WorldGenerationData::WORLD_HEIGHT) - 1, center.y + radius); y++)
         {
-            it = chunks.erase(it);
-            unloads++;
+            const bool yOutside = y < excludedMin.y || y > excludedMax.y;
+            for (int32_t z = center.z - radius; z <= center.z + radius; z++)
+            {
+                // skip the z-run that lies inside the excluded cube
+                if (!xOutside && !yOutside && z >= excludedMin.z && z <= excludedMax.z)
+                {
+                    z = excludedMax.z;
+                    continue;
+                }
+
+                func(glm::ivec3{x, y, z});
+            }
         }
-        else
-        {
-            ++it;
+    }
+}
 
-            chunk.inRender =
-                xDist < config.renderDistance &&
-                yDist < config.renderDistance &&
-                zDist < config.renderDistance;
+// cancels every pending job outside the radius, they are dropped by the worker unless already running
+static void cancelPendingJobs(std::unordered_map<glm::ivec3, PendingJob>& pending, const glm::ivec3& currChunkPos, const int32_t radius)
+{
+    for (auto it = pending.begin(); it != pending.end();)
+    {
+        if (isOutsideRadius(it->first, currChunkPos, radius))
+        {
+            it->second.token->store(true);
+            it = pending.erase(it);
         }
+        else
+            ++it;
     }
 }
 
-struct ChunkLoadRequest
+// a distance of 0 turns that level off
+static uint32_t getChunkLod(const GameConfig& config, const glm::ivec3& chunkPos, const glm::ivec3& currChunkPos)
 {
-    glm::ivec3 position;
-    float priority;
+    if (config.lod2Distance > 0 && isOutsideRadius(chunkPos, currChunkPos, int32_t(config.lod2Distance) - 1))
+        return 2;
+    if (config.lod1Distance > 0 && isOutsideRadius(chunkPos, currChunkPos, int32_t(config.lod1Distance) - 1))
+        return 1;
+    return 0;
+}
 
-    bool operator<(const ChunkLoadRequest& other) const { return priority > other.priority; }
-};
+void ChunkManager::setChunkLod(Chunk& chunk, const uint32_t lod)
+{
+    if (chunk.lod == lod)
+        return;
+
+    // the old mesh stays drawn until the new one is uploaded, the neighbours redo their seam faces
+    chunk.lod = lod;
+    invalidateMesh(chunk);
+    for (const auto& offset : NEIGHBOUR_OFFSETS)
+        if (Chunk* neighbour = getChunk(chunk.chunkPosition + offset))
+            invalidateMesh(*neighbour);
+}
+
+void ChunkManager::discardJob(const float ms)
+{
+    static const MetricID wastedMetric = registerMetric("Wasted Job Work");
+    pushMetricSample(wastedMetric, ms);
+    wastedJobs++;
+    wastedJobMs += ms;
+}
+
+void ChunkManager::updateFrontier(const glm::ivec3& currChunkPos)
+{
+    const auto load = int32_t(config.loadDistance);
+    // inRender is strict, the render cube reaches renderDistance - 1 chunks out
+    const int32_t render = int32_t(renderDistance) - 1;
+    if (hasFrontier && currChunkPos == frontierCenter && render == frontierRenderRadius)
+        return;
+
+    const glm::ivec3 oldCenter = frontierCenter;
+    const int32_t oldLoad = hasFrontier ? load : -1;
+    const int32_t oldUnload = hasFrontier ? load + UNLOAD_HYSTERESIS : -1;
+    const int32_t oldRender = hasFrontier ? frontierRenderRadius : -1;
+
+    forEachInCubeDifference(currChunkPos, load, oldCenter, oldLoad, [&](const glm::ivec3& pos)
+    {
+        loadQueue.push_back(pos);
+    });
+
+    if (hasFrontier)
+    {
+        forEachInCubeDifference(oldCenter, oldUnload, currChunkPos, load + UNLOAD_HYSTERESIS, [&](const glm::ivec3& pos)
+        {
+            if (chunks.contains(pos))
+                unloadQueue.push_back(pos);
+        });
+    }
+
+    forEachInCubeDifference(oldCenter, oldRender, currChunkPos, render, [&](const glm::ivec3& pos)
+    {
+        if (Chunk* chunk = getChunk(pos))
+            chunk->inRender = false;
+    });
+    forEachInCubeDifference(currChunkPos, render, oldCenter, oldRender, [&](const glm::ivec3& pos)
+    {
+        if (Chunk* chunk = getChunk(pos))
+        {
+            chunk->inRender = true;
+            meshQueue.push_back(pos);
+        }
+    });
+
+    // only chunks that crossed one of the level of detail rings change their level
+    if (hasFrontier)
+    {
+        for (const uint32_t lodDistance : {config.lod1Distance, config.lod2Distance})
+        {
+            if (lodDistance == 0)
+                continue;
+
+            const auto updateLod = [&](const glm::ivec3& pos)
+            {
+                if (Chunk* chunk = getChunk(pos))
+                    setChunkLod(*chunk, getChunkLod(config, pos, currChunkPos));
+            };
+            const int32_t radius = int32_t(lodDistance) - 1;
+            forEachInCubeDifference(oldCenter, radius, currChunkPos, radius, updateLod);
+            forEachInCubeDifference(currChunkPos, radius, oldCenter, radius, updateLod);
+        }
+    }
+
+    cancelPendingJobs(pendingLoads, currChunkPos, load + UNLOAD_HYSTERESIS);
+    cancelPendingJobs(pendingLights, currChunkPos, load + UNLOAD_HYSTERESIS);
+    cancelPendingJobs(pendingMeshes, currChunkPos, render + UNLOAD_HYSTERESIS);
 
-std::priority_queue<ChunkLoadRequest> getChunksSorted(const glm::ivec3& currChunkPos, const int32_t maxDist)
+    hasFrontier = true;
+    frontierCenter = currChunkPos;
+    frontierRenderRadius = render;
+}
+
+uint32_t ChunkManager::unloadChunks(const glm::ivec3& currChunkPos, WorldSaver& saver, const uint32_t maxUnloads)
 {
-    uint32_t chunksAdded = 0;
-    std::priority_queue<ChunkLoadRequest> queue;
-    for (int32_t x = currChunkPos.x - maxDist; x <= currChunkPos.x + maxDist; x++)
+    updateFrontier(currChunkPos);
+
+    std::vector<ChunkSnapshot> unsaved;
+    uint32_t unloads = 0;
+    size_t processed = 0;
+    for (; processed < unloadQueue.size() && unloads < maxUnloads; processed++)
     {
-        for (int32_t y = glm::max(0, currChunkPos.y - maxDist); y <= WorldGenerationData::WORLD_HEIGHT - 1 && y < currChunkPos.y + maxDist; y++)
+        const glm::ivec3 position = unloadQueue[processed];
+        const auto it = chunks.find(position);
+        // came back into range before we got to it
+        if (it == chunks.end() || !isOutsideRadius(position, currChunkPos, int32_t(config.loadDistance) + UNLOAD_HYSTERESIS))
+            continue;
+
+        Chunk& chunk = it->second;
+        if (chunk.isDirty)
+            unsaved.emplace_back(chunk.chunkPosition, std::move(chunk.blocks));
+        for (auto* pendingJobs : {&pendingMeshes, &pendingLights})
         {
-            for (int32_t z = currChunkPos.z - maxDist; z <= currChunkPos.z + maxDist; z++)
+            if (const auto pending = pendingJobs->find(position); pending != pendingJobs->end())
             {
-                glm::ivec3 chunkPos = {x, y, z};
-                const float distance = glm::length2(glm::vec3(chunkPos - currChunkPos));
-                queue.emplace(chunkPos, distance);
-                chunksAdded++;
+                pending->second.token->store(true);
+                pendingJobs->erase(pending);
             }
         }
+
+        pendingUploads.erase(position);
+        // no GL calls while erasing, the buffers are recycled or deleted later by uploadMeshes
+        meshBuffers.release(std::move(chunk.vaoOpaque));
+        meshBuffers.release(std::move(chunk.vaoTranslucent));
+        // their meshes and light stay, a neighbour that was meshed against this chunk only changes if it is edited
+        if (chunk.isLit)
+            for (const auto& offset : NEIGHBOUR_OFFSETS)
+                if (Chunk* neighbour = getChunk(position + offset))
+                    neighbour->missingNeighbours++;
+        chunks.erase(it);
+        // a chunk below that waited for this one has open sky above now
+        lightQueue.push_back(position - glm::ivec3{0, 1, 0});
+        unloads++;
     }
+    unloadQueue.erase(unloadQueue.begin(), unloadQueue.begin() + processed);
 
-    return queue;
+    saver.queueSnapshots(std::move(unsaved));
+    return unloads;
 }
 
-void ChunkManager::drawChunks(Renderer& renderer, const glm::mat4& viewProjection, const float exposure)
+struct ChunkLoadRequest
 {
-    renderer.prepareChunkRendering(viewProjection, exposure);
+    glm::ivec3 position;
+    float priority;
+};
+
+// Lower is loaded first. Chunks are ranked by their distance to where the player will be in
+// PREFETCH_SECONDS, chunks behind the look direction count up to twice as far away.
+static float getChunkPriority(const glm::ivec3& chunkPos, const glm::ivec3& currChunkPos, const StreamingFocus& focus)
+{
+    constexpr float PREFETCH_SECONDS = 0.3f;
+
+    // the chunks around the player always come first, nothing to stand on is worse than pop-in
+    const glm::ivec3 offset = glm::abs(chunkPos - currChunkPos);
+    if (offset.x <= 1 && offset.y <= 1 && offset.z <= 1)
+        return float(offset.x + offset.y + offset.z) * 0.01f;
+
+    const glm::vec3 predicted = (focus.position + focus.velocity * PREFETCH_SECONDS) / float(Chunk::CHUNK_SIZE);
+    const glm::vec3 toChunk = glm::vec3(chunkPos) + 0.5f - predicted;
+    const float distance2 = glm::length2(toChunk);
+    if (distance2 == 0.0f)
+        return 0.0f;
+
+    const float facing = glm::dot(toChunk / glm::sqrt(distance2), focus.lookDir);
+    return distance2 * (1.5f - 0.5f * facing);
+}
+
+// Ranks the queued positions, the first count of the result are the most urgent in order
+static std::vector<ChunkLoadRequest> getChunksSorted(const std::vector<glm::ivec3>& positions, const glm::ivec3& currChunkPos, const StreamingFocus& focus, const size_t count)
+{
+    std::vector<ChunkLoadRequest> requests;
+    requests.reserve(positions.size());
+    for (const auto& pos : positions)
+        requests.push_back({pos, getChunkPriority(pos, currChunkPos, focus)});
+
+    std::partial_sort(requests.begin(), requests.begin() + glm::min(count, requests.size()), requests.end(),
+        [](const ChunkLoadRequest& a, const ChunkLoadRequest& b) { return a.priority < b.priority; });
+    return requests;
+}
+
+// A face direction can only face the camera if the camera is in front of one of its planes, the chunk
+// bounds are a conservative stand-in for those. Adjacent visible directions are merged into one range.
+static uint32_t getVisibleFaceRanges(const Chunk& chunk, const glm::vec3& cameraPos, std::array<InstanceRange, 6>& ranges)
+{
+    const glm::vec3 min = chunkPosToWorldBlockPos(chunk.chunkPosition), max = min + float(Chunk::CHUNK_SIZE);
+    const std::array<bool, 6> visible = {
+        cameraPos.z < max.z, cameraPos.z > min.z,   // BACK, FRONT
+        cameraPos.x < max.x, cameraPos.x > min.x,   // LEFT, RIGHT
+        cameraPos.y < max.y, cameraPos.y > min.y    // BOTTOM, TOP
+    };
 
+    uint32_t rangeCount = 0;
+    GLuint first = 0;
+    // empty directions leave no gap, only skipped faces end a range
+    bool extendable = false;
+    for (uint32_t face = 0; face < 6; face++)
+    {
+        const GLuint count = chunk.meshFaceCounts[face];
+        if (count == 0)
+            continue;
+
+        if (visible[face] && extendable)
+            ranges[rangeCount - 1].count += count;
+        else if (visible[face])
+            ranges[rangeCount++] = {first, count};
+        extendable = visible[face];
+        first += count;
+    }
+
+    return rangeCount;
+}
+
+uint32_t ChunkManager::drawChunks(Renderer& renderer, const glm::vec3& cameraPos)
+{
+    uint32_t drawn = 0;
+    drawnPerLod = {};
+    facesPerLod = {};
+    drawnFaces = 0;
+    skippedFaces = 0;
+
+    // opaque front to back so early depth testing rejects what is hidden, translucent back to front to blend correctly
+    drawList.clear();
     for (const auto& [_,chunk] : chunks)
-        if (chunk.inRender && chunk.isMeshBaked)
-            renderer.drawChunk(chunk.vaoOpaque, chunkPosToWorldBlockPos(chunk.chunkPosition));
+    {
+        if (chunk.inRender && chunk.hasMesh)
+        {
+            const glm::vec3 center = glm::vec3(chunkPosToWorldBlockPos(chunk.chunkPosition)) + float(Chunk::CHUNK_SIZE) * 0.5f;
+            drawList.emplace_back(glm::length2(center - cameraPos), &chunk);
+        }
+    }
+    std::sort(drawList.begin(), drawList.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    drawOffsets.clear();
+    for (const auto& [_, chunk] : drawList)
+        drawOffsets.emplace_back(glm::vec3(chunkPosToWorldBlockPos(chunk->chunkPosition)), float(1 << chunk->meshLod));
+    renderer.prepareChunkRendering(drawOffsets);
+
+    std::array<InstanceRange, 6> ranges;
+    for (uint32_t i = 0; i < drawList.size(); i++)
+    {
+        const Chunk* chunk = drawList[i].second;
+        const uint32_t rangeCount = getVisibleFaceRanges(*chunk, cameraPos, ranges);
+        GLuint faces = 0;
+        for (uint32_t range = 0; range < rangeCount; range++)
+            faces += ranges[range].count;
+        drawnFaces += faces;
+        skippedFaces += chunk->vaoOpaque.vertexCount - faces;
+
+        renderer.drawChunk(chunk->vaoOpaque, i, std::span(ranges.data(), rangeCount));
+        drawnPerLod[chunk->meshLod]++;
+        facesPerLod[chunk->meshLod] += chunk->vaoOpaque.vertexCount + chunk->vaoTranslucent.vertexCount;
+        drawn++;
+    }
 
     glDisable(GL_CULL_FACE);
-    for (const auto& [_,chunk] : chunks)
-        if (chunk.inRender && chunk.isMeshBaked)
-            renderer.drawChunk(chunk.vaoTranslucent, chunkPosToWorldBlockPos(chunk.chunkPosition));
+    for (auto i = uint32_t(drawList.size()); i-- > 0;)
+        renderer.drawChunk(drawList[i].second->vaoTranslucent, i);
     glEnable(GL_CULL_FACE);
+
+    return drawn;
+}
+
+// a camera move of less than this many blocks keeps the translucent orders, they are only slightly off then
+constexpr float TRANSLUCENT_SORT_DISTANCE = 2.0f;
+// only chunks this close get sorted, further out the order barely shows
+constexpr int32_t TRANSLUCENT_SORT_RADIUS = 3;
+// the copies of the faces are kept one chunk further out, a chunk stepping into the sort radius has its copy then
+constexpr int32_t TRANSLUCENT_KEEP_RADIUS = TRANSLUCENT_SORT_RADIUS + 1;
+
+// Sorts faces back to front. A previous order for a nearby camera is almost right already, the insertion
+// sort then only moves a few faces. Returns false if the order did not change.
+static bool sortFacesBackToFront(Chunk::MeshData& faces, const glm::vec3& chunkOffset, const float scale, const glm::vec3& cameraPos, const bool presorted)
+{
+    constexpr glm::vec3 normals[] = {{0, 0, -1}, {0, 0, 1}, {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}};
+    thread_local std::vector<std::pair<float, blockdata>> keyed;
+    keyed.clear();
+    for (const blockdata face : faces)
+    {
+        const glm::vec3 center = chunkOffset + (glm::vec3(unpackBlockPosition(face)) + 0.5f + normals[unpackBlockFace(face)] * 0.5f) * scale;
+        keyed.emplace_back(glm::length2(center - cameraPos), face);
+    }
+
+    const auto further = [](const auto& a, const auto& b) { return a.first > b.first; };
+    if (std::is_sorted(keyed.begin(), keyed.end(), further))
+        return false;
+
+    if (presorted)
+    {
+        for (size_t i = 1; i < keyed.size(); i++)
+        {
+            const auto current = keyed[i];
+            size_t j = i;
+            for (; j > 0 && further(current, keyed[j - 1]); j--)
+                keyed[j] = keyed[j - 1];
+            keyed[j] = current;
+        }
+    }
+    else
+        std::sort(keyed.begin(), keyed.end(), further);
+
+    for (size_t i = 0; i < keyed.size(); i++)
+        faces[i] = keyed[i].second;
+    return true;
+}
+
+void ChunkManager::keepTranslucentFaces(Chunk& chunk, Chunk::MeshData&& faces)
+{
+    if (!config.sortTranslucentFaces)
+        return;
+
+    chunk.translucentRevision = chunk.meshRevision;
+    chunk.isTranslucentSorted = false;
+    // before the first sort the camera isn't known yet, the first sweep drops the copies that are too far
+    if (hasSortCamera && isOutsideRadius(chunk.chunkPosition, sortCameraChunk, TRANSLUCENT_KEEP_RADIUS))
+    {
+        Chunk::MeshData().swap(chunk.translucentFaces);
+        return;
+    }
+
+    chunk.translucentFaces = std::move(faces);
+    if (!chunk.translucentFaces.empty())
+        sortQueue.push_back(chunk.chunkPosition);
 }
 
-void ChunkManager::bakeChunks(const glm::ivec3& currChunkPos)
+uint32_t ChunkManager::sortTranslucentFaces(const glm::vec3& cameraPos)
 {
-    uint32_t chunksBaked = 0;
-    auto chunkQueue = getChunksSorted(currChunkPos, config.renderDistance);
+    if (!config.sortTranslucentFaces)
+        return 0;
 
-    while (!chunkQueue.empty())
+    std::vector<SortedFaces> finished;
     {
-        auto [position, priority] = chunkQueue.top();
-        chunkQueue.pop();
+        std::lock_guard lock(finishedMutex);
+        finished.swap(sortedFaces);
+    }
 
-        auto it = chunks.find(position);
-        if (it == chunks.end())
+    uint32_t uploads = 0;
+    for (auto& sorted : finished)
+    {
+        Chunk* chunk = getChunk(sorted.position);
+        if (!chunk)
             continue;
 
-        Chunk& chunk = it->second;
-        if (chunk.isMeshBaked || chunksBaked >= config.maxBakesPerFrame)
+        // a newer mesh was uploaded meanwhile and passed over while this sort was pending, it is queued again
+        // with the copy it brought
+        chunk->isSortPending = false;
+        if (chunk->translucentRevision != sorted.meshRevision || chunk->vaoTranslucent.vertexCount != sorted.faces.size())
+        {
+            sortQueue.push_back(sorted.position);
             continue;
+        }
 
-        chunksBaked++;
-        threadPool.queueJob([this, &chunk, position]()
-        {
-            std::array<Chunk*, 6> neighbourChunks{
-                // BACK, FRONT, LEFT, RIGHT, BOTTOM, TOP
-                getChunk(position + glm::ivec3{0, 0, -1}),
-                getChunk(position + glm::ivec3{0, 0, 1}),
-                getChunk(position + glm::ivec3{-1, 0, 0}),
-                getChunk(position + glm::ivec3{1, 0, 0}),
-                getChunk(position + glm::ivec3{0, -1, 0}),
-                getChunk(position + glm::ivec3{0, 1, 0})
-            };
+        chunk->translucentSortPos = sorted.cameraPos;
+        chunk->isTranslucentSorted = true;
+        if (sorted.changed)
+        {
+            GLCall(glBindBuffer(GL_ARRAY_BUFFER, chunk->vaoTranslucent.buffers[0]));
+            GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, GLsizeiptr(sorted.faces.size() * sizeof(blockdata)), sorted.faces.data()));
+            sortsUploaded++;
+            uploads++;
+        }
+        else
+            sortsKept++;
 
-            chunk.generateMeshData(neighbourChunks);
+        // the job took the copy, it is given back unless the camera left the chunk behind meanwhile
+        if (!isOutsideRadius(sorted.position, sortCameraChunk, TRANSLUCENT_KEEP_RADIUS))
+            chunk->translucentFaces = std::move(sorted.faces);
+    }
+
+    const glm::ivec3 cameraChunk = worldPosToChunkPos(glm::ivec3(glm::floor(cameraPos)));
+    if (!hasSortCamera || glm::distance(cameraPos, sortCameraPos) > TRANSLUCENT_SORT_DISTANCE)
+    {
+        // copies are only kept within the margin, a chunk that comes into it without one is remeshed on a worker
+        // so its faces are back before it gets sorted, the old mesh is drawn until then
+        if (!hasSortCamera || cameraChunk != sortCameraChunk)
+            for (auto& [pos, chunk] : chunks)
+            {
+                if (isOutsideRadius(pos, cameraChunk, TRANSLUCENT_KEEP_RADIUS))
+                    Chunk::MeshData().swap(chunk.translucentFaces);
+                else if (chunk.translucentFaces.empty() && chunk.isMeshBaked && !chunk.isSortPending && chunk.vaoTranslucent.vertexCount > 0)
+                    invalidateMesh(chunk);
+            }
+
+        hasSortCamera = true;
+        sortCameraPos = cameraPos;
+        sortCameraChunk = cameraChunk;
+        forEachInCubeDifference(cameraChunk, TRANSLUCENT_SORT_RADIUS, cameraChunk, -1, [&](const glm::ivec3& pos)
+        {
+            sortQueue.push_back(pos);
         });
     }
 
-    while (threadPool.busy())
-        std::this_thread::sleep_for(std::chrono::microseconds(1));
+    for (const auto& pos : sortQueue)
+    {
+        Chunk* chunk = getChunk(pos);
+        // without a copy the chunk waits for its new mesh
+        if (!chunk || !chunk->hasMesh || chunk->isSortPending || chunk->translucentFaces.empty() ||
+            isOutsideRadius(pos, cameraChunk, TRANSLUCENT_SORT_RADIUS))
+            continue;
+        if (chunk->isTranslucentSorted && glm::distance(cameraPos, chunk->translucentSortPos) <= TRANSLUCENT_SORT_DISTANCE)
+            continue;
 
-    for (auto& [_, chunk] : chunks)
+        chunk->isSortPending = true;
+        const glm::vec3 chunkOffset = chunkPosToWorldBlockPos(pos);
+        const float priority = glm::length2(chunkOffset + float(Chunk::CHUNK_SIZE) * 0.5f - cameraPos);
+        threadPool.queueJob([this, pos, chunkOffset, cameraPos, scale = float(1 << chunk->meshLod), presorted = chunk->isTranslucentSorted,
+                             revision = chunk->translucentRevision, faces = std::move(chunk->translucentFaces)]() mutable
+        {
+            const ScopedTrace trace("Sort Job", "job", pos);
+            const bool changed = sortFacesBackToFront(faces, chunkOffset, scale, cameraPos, presorted);
+
+            std::lock_guard lock(finishedMutex);
+            sortedFaces.push_back({pos, revision, cameraPos, std::move(faces), changed});
+        }, priority);
+    }
+    sortQueue.clear();
+
+    return uploads;
+}
+
+uint32_t ChunkManager::attachUploadedMeshes(const uint32_t maxUploads)
+{
+    for (const auto& pos : uploadQueue)
+    {
+        Chunk* chunk = getChunk(pos);
+        if (!chunk || !chunk->isMeshDataReady || chunk->isMeshBaked)
+            continue;
+
+        pendingUploads[pos] = chunk->meshRevision;
+        meshUploader->queueUpload({pos, chunk->meshRevision, std::move(chunk->meshDataOpaque), std::move(chunk->meshDataTranslucent), chunk->faceCounts});
+        chunk->releaseMeshData();
+    }
+    uploadQueue.clear();
+
+    VertexBufferLayout layout;
+    layout.pushUInt(BLOCKDATA_COMPONENTS, false, 1);
+    const auto attach = [&](VertexArray& vao, const GLuint buffer, const GLuint vertexCount)
+    {
+        if (vao.arrayID == 0)
+            vao = meshBuffers.acquire();
+        if (vao.buffers.empty())
+            vao.addBuffer(buffer, layout);
+        else
+            vao.replaceBuffers(buffer, layout);
+        vao.vertexCount = vertexCount;
+    };
+
+    // the quota only limits the attaching, the upload thread keeps working through the rest
+    std::vector<UploadedMesh> finished = meshUploader->collectUploads();
+    uploadedMeshes.insert(uploadedMeshes.end(), std::make_move_iterator(finished.begin()), std::make_move_iterator(finished.end()));
+
+    uint32_t uploads = 0;
+    size_t processed = 0;
+    for (; processed < uploadedMeshes.size() && uploads < maxUploads; processed++)
+    {
+        UploadedMesh& mesh = uploadedMeshes[processed];
+        const auto pending = pendingUploads.find(mesh.position);
+        if (pending != pendingUploads.end() && pending->second == mesh.meshRevision)
+            pendingUploads.erase(pending);
+
+        // unloaded or edited while the upload was in flight
+        Chunk* chunk = getChunk(mesh.position);
+        if (!chunk || chunk->meshRevision != mesh.meshRevision)
+        {
+            deleteUploadedMesh(mesh);
+            continue;
+        }
+
+        attach(chunk->vaoOpaque, mesh.bufferOpaque, mesh.vertexCountOpaque);
+        attach(chunk->vaoTranslucent, mesh.bufferTranslucent, mesh.vertexCountTranslucent);
+        chunk->gpuMemory.set(int64_t(mesh.vertexCountOpaque + mesh.vertexCountTranslucent) * sizeof(blockdata), 2);
+        commitMesh(*chunk, mesh.faceCountsOpaque, std::move(mesh.meshDataTranslucent));
+        uploads++;
+    }
+    uploadedMeshes.erase(uploadedMeshes.begin(), uploadedMeshes.begin() + processed);
+
+    return uploads;
+}
+
+uint32_t ChunkManager::uploadMeshes(const uint32_t maxUploads)
+{
+    meshBuffers.update();
+    if (meshUploader)
+        return attachUploadedMeshes(maxUploads);
+
+    const size_t budgetBytes = size_t(config.uploadBudgetKB) * 1024;
+    uploadedBytes = 0;
+    uint32_t uploads = 0;
+    size_t processed = 0;
+    for (; processed < uploadQueue.size() && uploads < maxUploads; processed++)
     {
-        if (chunk.isMeshDataReady && !chunk.isMeshBaked)
-            chunk.bakeMesh();
+        Chunk* chunk = getChunk(uploadQueue[processed]);
+        if (!chunk || !chunk->isMeshDataReady || chunk->isMeshBaked)
+            continue;
+
+        // a single mesh over the budget still goes through, it just gets the frame to itself
+        const size_t bytes = (chunk->meshDataOpaque.size() + chunk->meshDataTranslucent.size()) * sizeof(blockdata);
+        if (uploads > 0 && uploadedBytes + bytes > budgetBytes)
+            break;
+
+        // first upload of this chunk, take over the buffers of an unloaded one
+        if (chunk->vaoOpaque.arrayID == 0)
+            chunk->vaoOpaque = meshBuffers.acquire();
+        if (chunk->vaoTranslucent.arrayID == 0)
+            chunk->vaoTranslucent = meshBuffers.acquire();
+        chunk->bakeMesh();
+        commitMesh(*chunk, chunk->faceCounts, std::move(chunk->meshDataTranslucent));
+        uploadedBytes += bytes;
+        uploads++;
     }
+    uploadQueue.erase(uploadQueue.begin(), uploadQueue.begin() + processed);
 
-    //LOG_INFO("{} chunks baked", chunksBaked);
+    return uploads;
 }
 
-void ChunkManager::loadChunks(const glm::ivec3& currChunkPos, SQLite::Database& db)
+void ChunkManager::commitMesh(Chunk& chunk, const Chunk::FaceCounts& faceCountsOpaque, Chunk::MeshData&& translucentFaces)
 {
-    auto chunkQueue = getChunksSorted(currChunkPos, config.loadDistance);
-    glm::ivec3 chunkPositionsOfLoaded[config.maxLoadsPerFrame];
+    chunk.meshLod = chunk.lod;
+    chunk.meshFaceCounts = faceCountsOpaque;
+    keepTranslucentFaces(chunk, std::move(translucentFaces));
+    chunk.releaseMeshData();
+    chunk.isMeshBaked = true;
+    chunk.hasMesh = true;
+}
+
+uint32_t ChunkManager::meshChunks(const glm::ivec3& currChunkPos, const uint32_t maxMeshes)
+{
+    updateFrontier(currChunkPos);
+
+    std::vector<GeneratedMesh> finished;
+    {
+        std::lock_guard lock(finishedMutex);
+        finished.swap(generatedMeshes);
+    }
+
+    uint32_t chunksMeshed = 0;
+    for (auto& mesh : finished)
+    {
+        // counted before the job could be discarded, the cache saved its time either way
+        if (meshCache)
+        {
+            if (mesh.isCached)
+                meshCacheHits++;
+            else
+                meshCacheMisses++;
+            meshCacheSavedMs += (mesh.isCached ? mesh.cachedMs : 0.0) - mesh.cacheMs;
+        }
+
+        const auto pending = pendingMeshes.find(mesh.position);
+        Chunk* chunk = getChunk(mesh.position);
+        // cancelled while running, or the chunk was edited after the job took its snapshot
+        if (pending == pendingMeshes.end() || pending->second.token != mesh.token ||
+            !chunk || chunk->meshRevision != pending->second.meshRevision)
+        {
+            discardJob(mesh.ms);
+            continue;
+        }
+
+        pendingMeshes.erase(pending);
+        if (chunk->meshBuilds++ == 0)
+            chunksWithMesh++;
+        meshesBuilt++;
+        chunk->meshDataOpaque = std::move(mesh.meshDataOpaque);
+        chunk->meshDataTranslucent = std::move(mesh.meshDataTranslucent);
+        chunk->faceCounts = mesh.faceCountsOpaque;
+        chunk->isMeshDataReady = true;
+        uploadQueue.push_back(mesh.position);
+        chunksMeshed++;
+    }
+
+    // drop what no longer needs a mesh, a job already running for the current revision included. Chunks
+    // still waiting for a neighbour are queued again by setChunkLight once the last one is lit.
+    std::erase_if(meshQueue, [&](const glm::ivec3& pos)
+    {
+        const Chunk* chunk = getChunk(pos);
+        if (!chunk || !chunk->inRender || chunk->isMeshBaked || chunk->isMeshDataReady || !chunk->isLit || chunk->missingNeighbours > 0)
+            return true;
+        if (const auto upload = pendingUploads.find(pos); upload != pendingUploads.end() && upload->second == chunk->meshRevision)
+            return true;
+        const auto pending = pendingMeshes.find(pos);
+        return pending != pendingMeshes.end() && pending->second.meshRevision == chunk->meshRevision;
+    });
+
+    const size_t maxPending = threadPool.getThreadCount() * MAX_PENDING_JOBS_PER_THREAD;
+    const auto requests = getChunksSorted(meshQueue, currChunkPos, focus, maxMeshes);
+    uint32_t chunksQueued = 0;
+    for (size_t i = 0; i < requests.size() && chunksQueued < maxMeshes && pendingMeshes.size() < maxPending; i++)
+    {
+        const auto [position, priority] = requests[i];
+        Chunk& chunk = *getChunk(position);
+
+        // queued twice, or a job for an older revision that would be thrown away anyway
+        if (const auto pending = pendingMeshes.find(position); pending != pendingMeshes.end())
+        {
+            if (pending->second.meshRevision == chunk.meshRevision)
+                continue;
+            pending->second.token->store(true);
+        }
+
+        // the job meshes shared snapshots of the storages, edits on the main thread copy on write
+        std::array<std::shared_ptr<const Chunk::BlockStorage>, 6> neighbours;
+        std::array<std::optional<Chunk::LightStorage>, 6> neighbourLight;
+        for (uint32_t face = 0; face < 6; face++)
+        {
+            // border faces are only culled against neighbours at the same level of detail, see generateLodMeshData
+            const Chunk* neighbour = getChunk(position + NEIGHBOUR_OFFSETS[face]);
+            if (neighbour && neighbour->lod == chunk.lod)
+                neighbours[face] = neighbour->blocks;
+            // the light in front of a border face is the same at any level
+            if (neighbour && neighbour->isLit && chunk.lod == 0)
+                neighbourLight[face] = neighbour->light;
+        }
+        // only the corner occlusion of level 0 reads the edges and corners of the diagonal neighbours
+        std::array<std::shared_ptr<const Chunk::BlockStorage>, 20> diagonals;
+        for (uint32_t i = 0; i < diagonals.size() && chunk.lod == 0; i++)
+        {
+            const Chunk* diagonal = getChunk(position + DIAGONAL_OFFSETS[i]);
+            if (diagonal && diagonal->lod == 0)
+                diagonals[i] = diagonal->blocks;
+        }
+
+        const CancellationToken token = makeCancellationToken();
+        pendingMeshes[position] = {token, chunk.meshRevision};
+        chunksQueued++;
+        threadPool.queueJob([this, token, position, lod = chunk.lod, blocks = std::shared_ptr<const Chunk::BlockStorage>(chunk.blocks), neighbours,
+                             diagonals, light = chunk.light, neighbourLight]()
+        {
+            const ScopedTrace trace("Mesh Job", "job", position);
+            const auto start = std::chrono::steady_clock::now();
+
+            std::array<const Chunk::BlockStorage*, 6> neighbourBlocks;
+            std::array<const Chunk::LightStorage*, 6> neighbourLights{};
+            for (uint32_t face = 0; face < 6; face++)
+            {
+                neighbourBlocks[face] = neighbours[face].get();
+                if (neighbourLight[face])
+                    neighbourLights[face] = &*neighbourLight[face];
+            }
+            std::array<const Chunk::BlockStorage*, 20> diagonalBlocks;
+            for (uint32_t i = 0; i < diagonals.size(); i++)
+                diagonalBlocks[i] = diagonals[i].get();
+
+            GeneratedMesh mesh{token, position};
+            using Ms = std::chrono::duration<float, std::milli>;
+            MeshCacheKey key;
+            if (meshCache)
+            {
+                key = hashPaddedVolume(*blocks, neighbourBlocks, diagonalBlocks, light, neighbourLights, lod);
+                if (const auto cachedMs = meshCache->find(key, mesh))
+                {
+                    mesh.isCached = true;
+                    mesh.cachedMs = *cachedMs;
+                }
+                mesh.cacheMs = Ms(std::chrono::steady_clock::now() - start).count();
+            }
+
+            if (!mesh.isCached)
+            {
+                const auto meshStart = std::chrono::steady_clock::now();
+                if (lod == 0)
+                    generateMeshData(*blocks, neighbourBlocks, diagonalBlocks, light, neighbourLights, mesh.meshDataOpaque, mesh.meshDataTranslucent, mesh.faceCountsOpaque);
+                else
+                    generateLodMeshData(*blocks, neighbourBlocks, lod, mesh.meshDataOpaque, mesh.meshDataTranslucent, mesh.faceCountsOpaque);
+
+                if (meshCache)
+                {
+                    const auto insertStart = std::chrono::steady_clock::now();
+                    meshCache->insert(key, mesh, Ms(insertStart - meshStart).count());
+                    mesh.cacheMs += Ms(std::chrono::steady_clock::now() - insertStart).count();
+                }
+            }
+            mesh.ms = Ms(std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard lock(finishedMutex);
+            generatedMeshes.push_back(std::move(mesh));
+        }, priority, token);
+    }
+
+    return chunksMeshed;
+}
+
+uint32_t ChunkManager::loadChunks(const glm::ivec3& currChunkPos, SQLite::Database& db, const WorldSaver& saver, const uint32_t maxLoads)
+{
+    updateFrontier(currChunkPos);
+
+    std::vector<GeneratedChunk> finished;
+    {
+        std::lock_guard lock(finishedMutex);
+        // anything over the quota stays for the next frame
+        const size_t count = glm::min<size_t>(generatedChunks.size(), maxLoads);
+        finished.assign(std::make_move_iterator(generatedChunks.begin()), std::make_move_iterator(generatedChunks.begin() + count));
+        generatedChunks.erase(generatedChunks.begin(), generatedChunks.begin() + count);
+    }
+
     uint32_t chunksLoaded = 0;
-    while (!chunkQueue.empty() && chunksLoaded < config.maxLoadsPerFrame)
+    const auto addChunk = [&](Chunk&& loaded) -> Chunk&
     {
-        auto [position, priority] = chunkQueue.top();
-        chunkQueue.pop();
+        Chunk& chunk = chunks.emplace(loaded.chunkPosition, std::move(loaded)).first->second;
+        chunk.inRender = !isOutsideRadius(chunk.chunkPosition, frontierCenter, frontierRenderRadius);
+        chunk.lod = getChunkLod(config, chunk.chunkPosition, frontierCenter);
+
+        // a chunk is only meshed once all its neighbours are lit, its border faces and their light would be wrong
+        // otherwise. The chunk itself is meshed and counted by its neighbours once setChunkLight lit it.
+        chunk.missingNeighbours = 0;
+        for (const auto& offset : NEIGHBOUR_OFFSETS)
+        {
+            const glm::ivec3 neighbourPos = chunk.chunkPosition + offset;
+            if (!isInWorld(neighbourPos))
+                continue;
+
+            const Chunk* neighbour = getChunk(neighbourPos);
+            if (!neighbour || !neighbour->isLit)
+                chunk.missingNeighbours++;
+        }
+        // meshing doesn't wait for the diagonals, a diagonal meshed without this chunk took its corners as open
+        for (uint32_t i = 0; i < DIAGONAL_OFFSETS.size() && chunk.lod == 0; i++)
+        {
+            Chunk* diagonal = getChunk(chunk.chunkPosition + DIAGONAL_OFFSETS[i]);
+            if (diagonal && diagonal->lod == 0 && (diagonal->hasMesh || diagonal->isMeshDataReady || pendingMeshes.contains(diagonal->chunkPosition) ||
+                                                   pendingUploads.contains(diagonal->chunkPosition)) &&
+                hasOccluderTouching(*chunk.blocks, DIAGONAL_OFFSETS[i]))
+                invalidateMesh(*diagonal);
+        }
+        lightQueue.push_back(chunk.chunkPosition);
+        chunksLoaded++;
+        return chunk;
+    };
 
-        if (chunks.contains(position))
+    for (auto& generated : finished)
+    {
+        const glm::ivec3 position = generated.chunk.chunkPosition;
+        const auto pending = pendingLoads.find(position);
+        if (pending == pendingLoads.end() || pending->second.token != generated.token)
+        {
+            discardJob(generated.ms);
             continue;
+        }
 
-        chunkPositionsOfLoaded[chunksLoaded++] = position;
-        Chunk* chunk = &chunks.emplace(std::piecewise_construct, std::forward_as_tuple(position), std::forward_as_tuple()).first->second;
-        threadPool.queueJob([chunk, position, this]()
+        pendingLoads.erase(pending);
+        Chunk& chunk = addChunk(std::move(generated.chunk));
+        for (const auto& change : getBlockChangesForChunk(db, position))
+            chunk.setBlockUnsafe(change.positionInChunk, change.blockType);
+    }
+    collectLitChunks();
+
+    // drop what got loaded or left the radius since it was queued
+    std::erase_if(loadQueue, [&](const glm::ivec3& pos)
+    {
+        return chunks.contains(pos) || pendingLoads.contains(pos) || isOutsideRadius(pos, currChunkPos, int32_t(config.loadDistance));
+    });
+
+    const size_t maxPending = threadPool.getThreadCount() * MAX_PENDING_JOBS_PER_THREAD;
+    const auto requests = getChunksSorted(loadQueue, currChunkPos, focus, maxLoads);
+    uint32_t chunksQueued = 0;
+    for (size_t i = 0; i < requests.size() && chunksQueued < maxLoads && pendingLoads.size() < maxPending; i++)
+    {
+        const auto [position, priority] = requests[i];
+
+        // unloaded again before its autosave got written, the database is still behind
+        if (const auto unsaved = saver.findUnsaved(position))
         {
-            *chunk = Chunk(position, this->worldGenData);
-        });
+            Chunk chunk;
+            chunk.chunkPosition = position;
+            chunk.blocks = makeBlockStorage(*unsaved);
+            addChunk(std::move(chunk));
+            continue;
+        }
+
+        const CancellationToken token = makeCancellationToken();
+        pendingLoads[position] = {token};
+        chunksQueued++;
+        threadPool.queueJob([this, token, position]()
+        {
+            const ScopedTrace trace("Generation Job", "job", position);
+            const auto start = std::chrono::steady_clock::now();
+
+            GeneratedChunk generated{token, Chunk(position, worldGenData)};
+            generated.ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard lock(finishedMutex);
+            generatedChunks.push_back(std::move(generated));
+        }, priority, token);
+    }
+
+    queueLightJobs(currChunkPos);
+    return chunksLoaded;
+}
+
+bool ChunkManager::canLight(const glm::ivec3& chunkPos)
+{
+    const glm::ivec3 above = chunkPos + glm::ivec3{0, 1, 0};
+    if (!isInWorld(above))
+        return true;
+    if (const Chunk* chunk = getChunk(above))
+        return chunk->isLit;
+    // it won't be loaded while the player stays here
+    return isOutsideRadius(above, frontierCenter, int32_t(config.loadDistance));
+}
+
+void ChunkManager::collectLitChunks()
+{
+    std::vector<LitChunk> finished;
+    {
+        std::lock_guard lock(finishedMutex);
+        finished.swap(litChunks);
+    }
+
+    for (auto& lit : finished)
+    {
+        const auto pending = pendingLights.find(lit.position);
+        Chunk* chunk = getChunk(lit.position);
+        if (pending == pendingLights.end() || pending->second.token != lit.token || !chunk)
+        {
+            discardJob(lit.ms);
+            continue;
+        }
+        pendingLights.erase(pending);
+
+        // the blocks were edited or a neighbour lost light while the job ran, the result may hold light that is gone
+        bool isCurrent = lit.lightRevisions[6] == chunk->lightRevision;
+        for (uint32_t face = 0; face < 6 && isCurrent; face++)
+        {
+            if (lit.lightRevisions[face] == LitChunk::NOT_LIT)
+                continue;
+            const Chunk* neighbour = getChunk(lit.position + NEIGHBOUR_OFFSETS[face]);
+            isCurrent = neighbour && neighbour->isLit && neighbour->lightRevision == lit.lightRevisions[face];
+        }
+        if (!isCurrent)
+        {
+            discardJob(lit.ms);
+            lightQueue.push_back(lit.position);
+            continue;
+        }
+
+        // the job took an unloaded chunk above as open sky
+        chunk->hasAssumedSky = lit.lightRevisions[TOP] == LitChunk::NOT_LIT && isInWorld(lit.position + glm::ivec3{0, 1, 0});
+        setChunkLight(*chunk, std::move(lit.light));
+    }
+}
+
+void ChunkManager::queueLightJobs(const glm::ivec3& currChunkPos)
+{
+    // chunks that can't be lit yet are queued again once the chunk above is lit or unloaded
+    std::erase_if(lightQueue, [&](const glm::ivec3& pos)
+    {
+        const Chunk* chunk = getChunk(pos);
+        return !chunk || chunk->isLit || pendingLights.contains(pos) || !canLight(pos);
+    });
+
+    const size_t maxPending = threadPool.getThreadCount() * MAX_PENDING_JOBS_PER_THREAD;
+    const auto requests = getChunksSorted(lightQueue, currChunkPos, focus, maxPending);
+    for (size_t i = 0; i < requests.size() && pendingLights.size() < maxPending; i++)
+    {
+        const auto [position, priority] = requests[i];
+        // queued twice
+        if (pendingLights.contains(position))
+            continue;
+
+        const Chunk& chunk = *getChunk(position);
+        std::array<uint32_t, 7> revisions;
+        std::array<std::optional<Chunk::LightStorage>, 6> neighbourLight;
+        for (uint32_t face = 0; face < 6; face++)
+        {
+            const Chunk* neighbour = getChunk(position + NEIGHBOUR_OFFSETS[face]);
+            revisions[face] = neighbour && neighbour->isLit ? neighbour->lightRevision : LitChunk::NOT_LIT;
+            if (neighbour && neighbour->isLit)
+                neighbourLight[face] = neighbour->light;
+        }
+        revisions[6] = chunk.lightRevision;
+
+        const CancellationToken token = makeCancellationToken();
+        pendingLights[position] = {token};
+        threadPool.queueJob([this, token, position, revisions, blocks = std::shared_ptr<const Chunk::BlockStorage>(chunk.blocks), neighbourLight]()
+        {
+            const ScopedTrace trace("Light Job", "job", position);
+            const auto start = std::chrono::steady_clock::now();
+
+            std::array<const Chunk::LightStorage*, 6> neighbours{};
+            for (uint32_t face = 0; face < 6; face++)
+                if (neighbourLight[face])
+                    neighbours[face] = &*neighbourLight[face];
+
+            // only queued once canLight, whatever is above and not lit is open sky
+            LitChunk lit{token, position, {}, revisions};
+            fillChunkLight(*blocks, neighbours, true, lit.light);
+            lit.ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard lock(finishedMutex);
+            litChunks.push_back(std::move(lit));
+        }, priority, token);
     }
+}
 
-    while (threadPool.busy())
-        std::this_thread::sleep_for(std::chrono::microseconds(1));
+void ChunkManager::setChunkLight(Chunk& chunk, Chunk::LightStorage&& light)
+{
+    chunk.light = std::move(light);
+    chunk.isLit = true;
+    lightEngine->queueBorderExchange(chunk);
+    // the sky light assumed above the chunk below, or above this one if the chunk above was lit while its job ran
+    for (Chunk* lit : {&chunk, getChunk(chunk.chunkPosition - glm::ivec3{0, 1, 0})})
+    {
+        if (!lit || !lit->hasAssumedSky)
+            continue;
+        const Chunk* above = getChunk(lit->chunkPosition + glm::ivec3{0, 1, 0});
+        if (above && above->isLit)
+        {
+            lightEngine->queueSkyCorrection(*lit);
+            lit->hasAssumedSky = false;
+        }
+    }
+    propagateLight();
 
-    for (uint32_t i = 0; i < chunksLoaded; i++)
+    for (const auto& offset : NEIGHBOUR_OFFSETS)
     {
-        auto changes = getBlockChangesForChunk(db, chunkPositionsOfLoaded[i]);
-        Chunk* chunk = getChunk(chunkPositionsOfLoaded[i]);
-        for (const auto& change : changes)
-            chunk->setBlockUnsafe(change.positionInChunk, change.blockType);
+        Chunk* neighbour = getChunk(chunk.chunkPosition + offset);
+        if (neighbour && --neighbour->missingNeighbours == 0 && neighbour->isLit && neighbour->inRender)
+            meshQueue.push_back(neighbour->chunkPosition);
     }
+    if (chunk.inRender && chunk.missingNeighbours == 0)
+        meshQueue.push_back(chunk.chunkPosition);
 
-    //LOG_INFO("{} chunks loaded", chunksLoaded);
+    lightQueue.push_back(chunk.chunkPosition - glm::ivec3{0, 1, 0});
+}
+
+uint32_t ChunkManager::propagateLight()
+{
+    const uint32_t relit = lightEngine->propagate();
+    for (const auto& pos : lightEngine->changedChunks)
+        if (Chunk* chunk = getChunk(pos))
+            invalidateMesh(*chunk);
+    lightEngine->changedChunks.clear();
+    return relit;
 }
 
 void ChunkManager::dropChunkMeshes()
 {
     for (auto& [_, chunk] : chunks)
+        invalidateMesh(chunk);
+}
+
+void ChunkManager::invalidateMesh(Chunk& chunk)
+{
+    chunk.invalidateMesh();
+    meshQueue.push_back(chunk.chunkPosition);
+}
+
+void ChunkManager::setBlock(Chunk& chunk, const glm::ivec3& positionInChunk, const BLOCK_TYPE block)
+{
+    const BLOCK_TYPE oldBlock = chunk.getBlockUnsafe(positionInChunk);
+    chunk.setBlockUnsafe(positionInChunk, block);
+    markDirty(chunk);
+
+    // a neighbour at the same level reads 1 << lod blocks deep into this chunk, at another level it doesn't read it at all
+    const int32_t depth = 1 << chunk.lod;
+    for (uint32_t face = 0; face < 6; face++)
+    {
+        Chunk* neighbour = getChunk(chunk.chunkPosition + NEIGHBOUR_OFFSETS[face]);
+        if (!neighbour || neighbour->lod != chunk.lod)
+            continue;
+
+        const int32_t axis = face < 2 ? 2 : face < 4 ? 0 : 1;
+        const bool isBorder = face % 2 == 0 ? positionInChunk[axis] < depth : positionInChunk[axis] >= Chunk::CHUNK_SIZE - depth;
+        if (isBorder)
+            invalidateMesh(*neighbour);
+    }
+    // the corner occlusion of a level 0 diagonal reads the block if it sits on the edge or corner they share
+    for (const auto& offset : DIAGONAL_OFFSETS)
     {
-        chunk.isMeshBaked = false;
-        chunk.isMeshDataReady = false;
+        Chunk* diagonal = chunk.lod == 0 ? getChunk(chunk.chunkPosition + offset) : nullptr;
+        if (diagonal && diagonal->lod == 0 && isTouchingBlock(offset, positionInChunk))
+            invalidateMesh(*diagonal);
     }
+
+    // a light job for the chunk reads the old blocks
+    if (!chunk.isLit)
+    {
+        chunk.lightRevision++;
+        return;
+    }
+    if (getLightOpacity(oldBlock) == getLightOpacity(block) && getLightEmission(oldBlock) == getLightEmission(block))
+        return;
+
+    static const MetricID relightMetric = registerMetric("Relight");
+    const auto start = std::chrono::steady_clock::now();
+    lightEngine->queueBlockChange(chunkPosToWorldBlockPos(chunk.chunkPosition) + positionInChunk);
+    lastRelitVoxels = propagateLight();
+    lastRelightMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    pushMetricSample(relightMetric, float(lastRelightMs));
+    relights++;
+    relitVoxels += lastRelitVoxels;
+    relightMs += lastRelightMs;
+}
+
+void ChunkManager::markDirty(Chunk& chunk)
+{
+    // edited blocks need a new mesh as well as a save
+    meshQueue.push_back(chunk.chunkPosition);
+    if (chunk.isDirty)
+        return;
+
+    chunk.isDirty = true;
+    dirtyChunks.push_back(chunk.chunkPosition);
+}
+
+std::vector<ChunkSnapshot> ChunkManager::snapshotDirtyChunks()
+{
+    std::vector<ChunkSnapshot> snapshots;
+    snapshots.reserve(dirtyChunks.size());
+
+    for (const auto& pos : dirtyChunks)
+    {
+        Chunk* chunk = getChunk(pos);
+        if (!chunk || !chunk->isDirty)
+            continue;
+
+        // the next edit copies the storage, the snapshot keeps this state
+        chunk->isDirty = false;
+        snapshots.emplace_back(pos, chunk->blocks);
+    }
+
+    dirtyChunks.clear();
+    return snapshots;
 }
 
 Chunk* ChunkManager::getChunk(const glm::ivec3& pos)
@@ -193,33 +1187,38 @@ Chunk* ChunkManager::getChunk(const glm::ivec3& pos)
 static uint32_t getBlockIndex(const glm::ivec3& pos) { return pos.x + pos.y * Chunk::CHUNK_SIZE + pos.z * Chunk::CHUNK_SIZE * Chunk::CHUNK_SIZE; }
 
 Chunk::Chunk()
-    : blocks{}, chunkPosition(0)
+    : blocks(makeBlockStorage()), chunkPosition(0)
 {
 }
 
 const int32_t TREE_HEIGHT = 6;
 
-void Chunk::spawnTree(const glm::ivec3& pos)
+static void spawnTree(Chunk::BlockStorage& blocks, const glm::ivec3& pos)
 {
     for (int32_t y = 0; y < TREE_HEIGHT; y++)
-        setBlockUnsafe({pos.x, pos.y + y, pos.z}, BLOCK_TYPE::WOOD);
+        blocks[getBlockIndex({pos.x, pos.y + y, pos.z})] = BLOCK_TYPE::WOOD;
 
     for (int32_t x = -1; x <= 1; x++)
         for (int32_t z = -1; z <= 1; z++)
-            setBlockUnsafe({pos.x + x, pos.y + TREE_HEIGHT - 1, pos.z + z}, BLOCK_TYPE::LEAVES);
+            blocks[getBlockIndex({pos.x + x, pos.y + TREE_HEIGHT - 1, pos.z + z})] = BLOCK_TYPE::LEAVES;
 }
 
 Chunk::Chunk(const glm::ivec3& chunkPosition, const WorldGenerationData& worldGenData)
-    : blocks{}, chunkPosition(chunkPosition)
+    : blocks(makeBlockStorage()), chunkPosition(chunkPosition)
 {
-    meshDataOpaque.reserve(BLOCKS_PER_CHUNK / 2);
-    meshDataTranslucent.reserve(BLOCKS_PER_CHUNK / 2);
+    CAPTURE_SCOPE("Chunk Generation");
+    generateTerrain(*blocks, chunkPosition, worldGenData);
+}
 
+void generateTerrain(Chunk::BlockStorage& blocks, const glm::ivec3& chunkPosition, const WorldGenerationData& worldGenData)
+{
+    constexpr int32_t CHUNK_SIZE = Chunk::CHUNK_SIZE;
     const glm::ivec3 absChunkPos = chunkPosToWorldBlockPos(chunkPosition);
     const int32_t chunkHeight = chunkPosition.y * CHUNK_SIZE;
     bool forestChunk = worldGenData.isForest({absChunkPos.x, absChunkPos.z});
     const int32_t SURFACE_HEIGHT = 3;
 
+    blocks.fill(BLOCK_TYPE::INVALID);
 
     for (int32_t x = 0; x < CHUNK_SIZE; x++)
     {
@@ -245,7 +1244,7 @@ Chunk::Chunk(const glm::ivec3& chunkPosition, const WorldGenerationData& worldGe
                 if (tree)
                 {
                     int32_t trunkY = terrainHeight - chunkHeight;
-                    spawnTree(glm::ivec3{x, trunkY, z});
+                    spawnTree(blocks, glm::ivec3{x, trunkY, z});
                 }
             }
 
@@ -272,10 +1271,159 @@ Chunk::Chunk(const glm::ivec3& chunkPosition, const WorldGenerationData& worldGe
     }
 }
 
-void Chunk::generateMeshData(const std::array<Chunk*, 6>& neighbourChunks)
+void Chunk::generateMeshData(const std::array<Chunk*, 6>& neighbourChunks, const std::array<Chunk*, 20>& diagonalChunks)
+{
+    std::array<const BlockStorage*, 6> neighbours{};
+    std::array<const BlockStorage*, 20> diagonals{};
+    for (uint32_t i = 0; i < diagonals.size(); i++)
+        if (diagonalChunks[i])
+            diagonals[i] = diagonalChunks[i]->blocks.get();
+    std::array<const LightStorage*, 6> neighbourLight{};
+    for (uint32_t face = 0; face < 6; face++)
+    {
+        if (!neighbourChunks[face])
+            continue;
+        neighbours[face] = neighbourChunks[face]->blocks.get();
+        if (neighbourChunks[face]->isLit)
+            neighbourLight[face] = &neighbourChunks[face]->light;
+    }
+
+    ::generateMeshData(*blocks, neighbours, diagonals, light, neighbourLight, meshDataOpaque, meshDataTranslucent, faceCounts);
+    isMeshDataReady = true;
+    isMeshBaked = false;
+}
+
+// Copies the per-direction buckets back to back in face order
+static void joinFaceBuckets(const std::array<Chunk::MeshData, 6>& buckets, Chunk::MeshData& meshData, Chunk::FaceCounts& faceCounts)
+{
+    size_t total = 0;
+    for (uint32_t face = 0; face < 6; face++)
+    {
+        faceCounts[face] = uint32_t(buckets[face].size());
+        total += buckets[face].size();
+    }
+
+    meshData = Chunk::MeshData();
+    meshData.reserve(total);
+    for (const auto& bucket : buckets)
+        meshData.insert(meshData.end(), bucket.begin(), bucket.end());
+}
+
+// The chunk with one cell of its neighbours around it, 1 where a block shades the corners next to it
+constexpr int32_t OCCLUSION_SIZE = Chunk::CHUNK_SIZE + 2;
+using OcclusionVolume = std::array<uint8_t, OCCLUSION_SIZE * OCCLUSION_SIZE * OCCLUSION_SIZE>;
+
+static constexpr int32_t getOcclusionIndex(const glm::ivec3& pos) { return pos.x + pos.y * OCCLUSION_SIZE + pos.z * OCCLUSION_SIZE * OCCLUSION_SIZE; }
+
+// Corners of each face in the order BlockVert.glsl draws them
+constexpr glm::ivec3 FACE_CORNERS[6][4] = {
+    {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}}, // BACK
+    {{0, 0, 1}, {0, 1, 1}, {1, 1, 1}, {1, 0, 1}}, // FRONT
+    {{0, 0, 1}, {0, 0, 0}, {0, 1, 0}, {0, 1, 1}}, // LEFT
+    {{1, 0, 0}, {1, 0, 1}, {1, 1, 1}, {1, 1, 0}}, // RIGHT
+    {{0, 0, 0}, {0, 0, 1}, {1, 0, 1}, {1, 0, 0}}, // BOTTOM
+    {{0, 1, 0}, {1, 1, 0}, {1, 1, 1}, {0, 1, 1}}  // TOP
+};
+
+// Per face and corner the index offsets from a block to the two cells beside the corner and the one
+// diagonal to it, all in the layer in front of the face
+static const auto OCCLUSION_OFFSETS = []
 {
-    meshDataOpaque.clear();
-    meshDataTranslucent.clear();
+    std::array<std::array<std::array<int32_t, 3>, 4>, 6> offsets{};
+    for (uint32_t face = 0; face < 6; face++)
+    {
+        const int32_t axis = face < 2 ? 2 : face < 4 ? 0 : 1;
+        glm::ivec3 normal{0};
+        normal[axis] = face % 2 == 0 ? -1 : 1;
+        for (uint32_t corner = 0; corner < 4; corner++)
+        {
+            glm::ivec3 side1{0}, side2{0};
+            side1[(axis + 1) % 3] = FACE_CORNERS[face][corner][(axis + 1) % 3] * 2 - 1;
+            side2[(axis + 2) % 3] = FACE_CORNERS[face][corner][(axis + 2) % 3] * 2 - 1;
+            offsets[face][corner] = {getOcclusionIndex(normal + side1), getOcclusionIndex(normal + side2),
+                                     getOcclusionIndex(normal + side1 + side2)};
+        }
+    }
+    return offsets;
+}();
+
+// Opaque blocks of the chunk and of the slab, row or block of each neighbour touching it
+static void fillOcclusionVolume(const Chunk::BlockStorage& blocks, const std::array<const Chunk::BlockStorage*, 6>& neighbours,
+                                const std::array<const Chunk::BlockStorage*, 20>& diagonals, OcclusionVolume& occluders)
+{
+    constexpr int32_t SIZE = Chunk::CHUNK_SIZE;
+    static const auto OCCLUDES = []
+    {
+        std::array<uint8_t, BLOCK_NAMES.size()> occludes{};
+        for (size_t i = 0; i < occludes.size(); i++)
+            occludes[i] = BLOCK_TYPE(i) != BLOCK_TYPE::AIR && !isTranslucent(BLOCK_TYPE(i));
+        return occludes;
+    }();
+
+    occluders.fill(0);
+    for (int32_t z = 0; z < SIZE; z++)
+        for (int32_t y = 0; y < SIZE; y++)
+        {
+            const int32_t row = getBlockIndex({0, y, z}), paddedRow = getOcclusionIndex({1, y + 1, z + 1});
+            for (int32_t x = 0; x < SIZE; x++)
+                occluders[paddedRow + x] = OCCLUDES[size_t(blocks[row + x])];
+        }
+
+    // a block of the neighbour at offset lands a chunk further along offset in the padding
+    const auto fillNeighbour = [&](const Chunk::BlockStorage* neighbour, const glm::ivec3& offset)
+    {
+        if (!neighbour)
+            return;
+        forEachTouchingBlock(offset, [&](const glm::ivec3& pos)
+        {
+            occluders[getOcclusionIndex(pos + 1 + offset * SIZE)] = OCCLUDES[size_t((*neighbour)[getBlockIndex(pos)])];
+        });
+    };
+    for (uint32_t face = 0; face < 6; face++)
+        fillNeighbour(neighbours[face], NEIGHBOUR_OFFSETS[face]);
+    for (uint32_t i = 0; i < diagonals.size(); i++)
+        fillNeighbour(diagonals[i], DIAGONAL_OFFSETS[i]);
+}
+
+// 2 bits per corner of the face of the block at base, 3 minus the shading cells around the corner, 0 when
+// both cells beside it are blocked since they hide the diagonal one
+static uint8_t getCornerOcclusion(const OcclusionVolume& occluders, const int32_t base, const uint32_t face)
+{
+    uint32_t occlusion = 0;
+    for (uint32_t corner = 0; corner < 4; corner++)
+    {
+        const auto& offsets = OCCLUSION_OFFSETS[face][corner];
+        const uint32_t side1 = occluders[base + offsets[0]], side2 = occluders[base + offsets[1]];
+        const uint32_t open = side1 & side2 ? 0 : 3 - side1 - side2 - occluders[base + offsets[2]];
+        occlusion |= open << (corner * 2);
+    }
+    return uint8_t(occlusion);
+}
+
+void generateMeshData(const Chunk::BlockStorage& blocks, const std::array<const Chunk::BlockStorage*, 6>& neighbours,
+                      const std::array<const Chunk::BlockStorage*, 20>& diagonals, const Chunk::LightStorage& light, const std::array<const Chunk::LightStorage*, 6>& neighbourLight,
+                      Chunk::MeshData& meshDataOpaque, Chunk::MeshData& meshDataTranslucent, Chunk::FaceCounts& faceCountsOpaque)
+{
+    CAPTURE_SCOPE("Mesh Generation");
+    constexpr int32_t CHUNK_SIZE = Chunk::CHUNK_SIZE;
+    using MeshData = Chunk::MeshData;
+
+    // meshing happens in per-thread scratch that keeps its capacity, the chunk only gets exactly sized copies.
+    // Opaque faces are bucketed by direction so whole directions can be skipped when drawing.
+    thread_local std::array<MeshData, 6> scratchOpaque;
+    thread_local MeshData scratchTranslucent;
+    if (scratchTranslucent.capacity() == 0)
+    {
+        for (auto& bucket : scratchOpaque)
+            bucket.reserve(Chunk::BLOCKS_PER_CHUNK / 8);
+        scratchTranslucent.reserve(Chunk::BLOCKS_PER_CHUNK / 2);
+    }
+    for (auto& bucket : scratchOpaque)
+        bucket.clear();
+    scratchTranslucent.clear();
+
+    thread_local OcclusionVolume occluders;
+    fillOcclusionVolume(blocks, neighbours, diagonals, occluders);
 
     constexpr glm::ivec3 neighborOffsets[] = {
         {0, 0, -1}, // BACK
@@ -285,6 +1433,10 @@ void Chunk::generateMeshData(const std::array<Chunk*, 6>& neighbourChunks)
         {0, -1, 0},  // BOTTOM
         {0, 1, 0}  // TOP
     };
+    constexpr int32_t occluderOffsets[] = {
+        getOcclusionIndex(neighborOffsets[BACK]), getOcclusionIndex(neighborOffsets[FRONT]), getOcclusionIndex(neighborOffsets[LEFT]),
+        getOcclusionIndex(neighborOffsets[RIGHT]), getOcclusionIndex(neighborOffsets[BOTTOM]), getOcclusionIndex(neighborOffsets[TOP])
+    };
 
     for (uint32_t z = 0; z < CHUNK_SIZE; z++)
     {
@@ -293,23 +1445,29 @@ void Chunk::generateMeshData(const std::array<Chunk*, 6>& neighbourChunks)
             for (uint32_t x = 0; x < CHUNK_SIZE; x++)
             {
                 glm::uvec3 blockPos = {x, y, z};
-                const BLOCK_TYPE block = getBlockUnsafe(blockPos);
+                const BLOCK_TYPE block = blocks[getBlockIndex(blockPos)];
 
                 assert(block != BLOCK_TYPE::INVALID);
                 if (block == BLOCK_TYPE::AIR)
                     continue;
 
+                const bool translucent = isTranslucent(block);
+                const int32_t occluderIndex = getOcclusionIndex(glm::ivec3(blockPos) + 1);
                 for (uint32_t face = 0; face < 6; face++)
                 {
                     if (face == BOTTOM && y == 0)
                         continue;
+                    // an opaque block in front hides the face whatever this one is, most faces end here
+                    if (occluders[occluderIndex + occluderOffsets[face]])
+                        continue;
 
                     glm::ivec3 neighbourBlockPos = glm::ivec3(blockPos) + neighborOffsets[face];
 
-                    BLOCK_TYPE neighbourBlock = getBlockSafe(neighbourBlockPos);
-                    if (neighbourBlock != BLOCK_TYPE::INVALID && neighbourBlock != BLOCK_TYPE::AIR && !(!isTranslucent(block) && isTranslucent(neighbourBlock)))
+                    BLOCK_TYPE neighbourBlock = isChunkCoord(neighbourBlockPos) ? blocks[getBlockIndex(neighbourBlockPos)] : BLOCK_TYPE::INVALID;
+                    if (neighbourBlock != BLOCK_TYPE::INVALID && neighbourBlock != BLOCK_TYPE::AIR && !(!translucent && isTranslucent(neighbourBlock)))
                         continue;
 
+                    uint8_t faceLight = OPEN_SKY_LIGHT;
                     if (neighbourBlock == BLOCK_TYPE::INVALID)
                     {
                         glm::uvec3 blockPosInOtherChunk;
@@ -317,39 +1475,145 @@ void Chunk::generateMeshData(const std::array<Chunk*, 6>& neighbourChunks)
                         blockPosInOtherChunk.y = (neighbourBlockPos.y % CHUNK_SIZE + CHUNK_SIZE) % CHUNK_SIZE;
                         blockPosInOtherChunk.z = (neighbourBlockPos.z % CHUNK_SIZE + CHUNK_SIZE) % CHUNK_SIZE;
 
-                        Chunk* neighborChunk = neighbourChunks[face];
-
-                        if (neighborChunk)
+                        if (const Chunk::BlockStorage* neighbourBlocks = neighbours[face])
                         {
-                            neighbourBlock = neighborChunk->getBlockUnsafe(blockPosInOtherChunk);
+                            neighbourBlock = (*neighbourBlocks)[getBlockIndex(blockPosInOtherChunk)];
                             if (neighbourBlock != BLOCK_TYPE::AIR && !(block != BLOCK_TYPE::WATER && neighbourBlock == BLOCK_TYPE::WATER))
                                 continue;
                         }
+                        if (const Chunk::LightStorage* otherLight = neighbourLight[face])
+                            faceLight = otherLight->get(getBlockIndex(blockPosInOtherChunk));
                     }
+                    else
+                        faceLight = light.get(getBlockIndex(neighbourBlockPos));
 
                     auto atlasOffset = getAtlasOffset(block, FACE(face));
-                    if (isTranslucent(block))
-                        meshDataTranslucent.push_back(packBlockData(blockPos, atlasOffset, FACE(face)));
+                    const uint8_t occlusion = getCornerOcclusion(occluders, occluderIndex, face);
+                    if (translucent)
+                        scratchTranslucent.push_back(packBlockData(blockPos, atlasOffset, FACE(face), faceLight, occlusion));
                     else
-                        meshDataOpaque.push_back(packBlockData(blockPos, atlasOffset, FACE(face)));
+                        scratchOpaque[face].push_back(packBlockData(blockPos, atlasOffset, FACE(face), faceLight, occlusion));
                 }
             }
         }
     }
 
-    isMeshDataReady = true;
-    isMeshBaked = false;
+    joinFaceBuckets(scratchOpaque, meshDataOpaque, faceCountsOpaque);
+    meshDataTranslucent = MeshData(scratchTranslucent.begin(), scratchTranslucent.end());
 }
 
-void bake(VertexArray& vao, const std::vector<blockdata>& meshData)
+// Block of a scale^3 cell: solid if at least half of it is, then the topmost solid block so grass stays
+// on top, else water if that fills half of it
+static BLOCK_TYPE downsampleCell(const Chunk::BlockStorage& blocks, const glm::ivec3& base, const int32_t scale)
 {
-    VertexBufferLayout layout;
-    layout.pushUInt(1, false, 1);
+    int32_t solid = 0, water = 0;
+    BLOCK_TYPE top = BLOCK_TYPE::AIR;
+    for (int32_t y = scale - 1; y >= 0; y--)
+    {
+        for (int32_t z = 0; z < scale; z++)
+        {
+            for (int32_t x = 0; x < scale; x++)
+            {
+                const BLOCK_TYPE block = blocks[getBlockIndex(base + glm::ivec3{x, y, z})];
+                if (block == BLOCK_TYPE::AIR)
+                    continue;
+                if (block == BLOCK_TYPE::WATER)
+                {
+                    water++;
+                    continue;
+                }
+
+                solid++;
+                if (top == BLOCK_TYPE::AIR)
+                    top = block;
+            }
+        }
+    }
+
+    const int32_t half = scale * scale * scale / 2;
+    if (solid >= half)
+        return top;
+    if (solid + water >= half)
+        return BLOCK_TYPE::WATER;
+    return BLOCK_TYPE::AIR;
+}
+
+void generateLodMeshData(const Chunk::BlockStorage& blocks, const std::array<const Chunk::BlockStorage*, 6>& neighbours, const uint32_t lod,
+                         Chunk::MeshData& meshDataOpaque, Chunk::MeshData& meshDataTranslucent, Chunk::FaceCounts& faceCountsOpaque)
+{
+    CAPTURE_SCOPE("LOD Mesh Generation");
+    const int32_t scale = 1 << lod;
+    const int32_t size = Chunk::CHUNK_SIZE / scale;
+    using MeshData = Chunk::MeshData;
+
+    thread_local std::vector<BLOCK_TYPE> cells;
+    thread_local std::array<MeshData, 6> scratchOpaque;
+    thread_local MeshData scratchTranslucent;
+    cells.resize(size * size * size);
+    for (auto& bucket : scratchOpaque)
+        bucket.clear();
+    scratchTranslucent.clear();
+
+    const auto cellIndex = [size](const glm::ivec3& pos) { return pos.x + pos.y * size + pos.z * size * size; };
+    for (int32_t z = 0; z < size; z++)
+        for (int32_t y = 0; y < size; y++)
+            for (int32_t x = 0; x < size; x++)
+                cells[cellIndex({x, y, z})] = downsampleCell(blocks, glm::ivec3{x, y, z} * scale, scale);
+
+    constexpr glm::ivec3 neighborOffsets[] = {{0, 0, -1}, {0, 0, 1}, {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}};
+    for (int32_t z = 0; z < size; z++)
+    {
+        for (int32_t y = 0; y < size; y++)
+        {
+            for (int32_t x = 0; x < size; x++)
+            {
+                const glm::ivec3 cellPos{x, y, z};
+                const BLOCK_TYPE block = cells[cellIndex(cellPos)];
+                if (block == BLOCK_TYPE::AIR)
+                    continue;
+
+                for (uint32_t face = 0; face < 6; face++)
+                {
+                    if (face == BOTTOM && y == 0)
+                        continue;
+
+                    const glm::ivec3 neighbourPos = cellPos + neighborOffsets[face];
+                    BLOCK_TYPE neighbourBlock = BLOCK_TYPE::AIR;
+                    if (glm::all(glm::greaterThanEqual(neighbourPos, glm::ivec3(0))) && glm::all(glm::lessThan(neighbourPos, glm::ivec3(size))))
+                        neighbourBlock = cells[cellIndex(neighbourPos)];
+                    // only neighbours at the same level are passed in, faces towards the others stay to close the seam
+                    else if (const Chunk::BlockStorage* neighbourBlocks = neighbours[face])
+                        neighbourBlock = downsampleCell(*neighbourBlocks, ((neighbourPos % size + size) % size) * scale, scale);
+
+                    if (neighbourBlock != BLOCK_TYPE::AIR && !(!isTranslucent(block) && isTranslucent(neighbourBlock)))
+                        continue;
+
+                    const auto atlasOffset = getAtlasOffset(block, FACE(face));
+                    if (isTranslucent(block))
+                        scratchTranslucent.push_back(packBlockData(glm::uvec3(cellPos), atlasOffset, FACE(face), OPEN_SKY_LIGHT, NO_OCCLUSION));
+                    else
+                        scratchOpaque[face].push_back(packBlockData(glm::uvec3(cellPos), atlasOffset, FACE(face), OPEN_SKY_LIGHT, NO_OCCLUSION));
+                }
+            }
+        }
+    }
 
-    const GLuint instanceVbo = createBuffer(meshData.data(), meshData.size() * sizeof(blockdata));
+    joinFaceBuckets(scratchOpaque, meshDataOpaque, faceCountsOpaque);
+    meshDataTranslucent = MeshData(scratchTranslucent.begin(), scratchTranslucent.end());
+}
 
-    vao.reset();
-    vao.addBuffer(instanceVbo, layout);
+void bake(VertexArray& vao, const Chunk::MeshData& meshData)
+{
+    // a remeshed or recycled vertex array keeps its attribute setup, only the data store is respecified
+    if (vao.buffers.empty())
+    {
+        VertexBufferLayout layout;
+        layout.pushUInt(BLOCKDATA_COMPONENTS, false, 1);
+        vao.addBuffer(createBuffer(nullptr, 0), layout);
+    }
+
+    GLCall(glBindBuffer(GL_ARRAY_BUFFER, vao.buffers[0]))
+    GLCall(glBufferData(GL_ARRAY_BUFFER, GLsizeiptr(meshData.size() * sizeof(blockdata)), meshData.data(), GL_STATIC_DRAW))
     vao.vertexCount = meshData.size();
 }
 
@@ -357,12 +1621,27 @@ void Chunk::bakeMesh()
 {
     bake(vaoOpaque, meshDataOpaque);
     bake(vaoTranslucent, meshDataTranslucent);
-    isMeshBaked = true;
+    gpuMemory.set(int64_t(meshDataOpaque.size() + meshDataTranslucent.size()) * sizeof(blockdata), 2);
+}
+
+void Chunk::releaseMeshData()
+{
+    // swap instead of clear so the allocation is actually returned
+    MeshData().swap(meshDataOpaque);
+    MeshData().swap(meshDataTranslucent);
+    isMeshDataReady = false;
+}
+
+void Chunk::invalidateMesh()
+{
+    meshRevision++;
+    isMeshBaked = false;
+    releaseMeshData();
 }
 
 BLOCK_TYPE Chunk::getBlockUnsafe(const glm::ivec3& pos) const
 {
-    return blocks[getBlockIndex(pos)];
+    return (*blocks)[getBlockIndex(pos)];
 }
 
 BLOCK_TYPE Chunk::getBlockSafe(const glm::ivec3& pos) const
@@ -375,9 +1654,12 @@ BLOCK_TYPE Chunk::getBlockSafe(const glm::ivec3& pos) const
 
 void Chunk::setBlockUnsafe(const glm::ivec3& pos, const BLOCK_TYPE block)
 {
-    blocks[getBlockIndex(pos)] = block;
-    isMeshBaked = false;
-    isMeshDataReady = false;
+    // an autosave snapshot still references the storage, copy on write
+    if (blocks.use_count() > 1)
+        blocks = makeBlockStorage(*blocks);
+
+    (*blocks)[getBlockIndex(pos)] = block;
+    invalidateMesh();
 }
 
 void Chunk::setBlockSafe(const glm::ivec3& pos, const BLOCK_TYPE block)
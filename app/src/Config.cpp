@@ -41,6 +41,34 @@ bool loadConfig(const char* path, GameConfig& config)
             config.worldSeed = (uint32_t) (int32_t) cfg.lookup("worldSeed");
         if (cfg.exists("reachDistance"))
             config.reachDistance = cfg.lookup("reachDistance");
+        if (cfg.exists("compactionThreshold"))
+            config.compactionThreshold = (uint32_t) (int32_t) cfg.lookup("compactionThreshold");
+        if (cfg.exists("autosaveInterval"))
+            config.autosaveInterval = cfg.lookup("autosaveInterval");
+        if (cfg.exists("frameBudgetMs"))
+            config.frameBudgetMs = cfg.lookup("frameBudgetMs");
+        if (cfg.exists("dynamicRenderDistance"))
+            config.dynamicRenderDistance = cfg.lookup("dynamicRenderDistance");
+        if (cfg.exists("minRenderDistance"))
+            config.minRenderDistance = (uint32_t) (int32_t) cfg.lookup("minRenderDistance");
+        if (cfg.exists("uploadBudgetKB"))
+            config.uploadBudgetKB = (uint32_t) (int32_t) cfg.lookup("uploadBudgetKB");
+        if (cfg.exists("uploadThread"))
+            config.uploadThread = cfg.lookup("uploadThread");
+        if (cfg.exists("lod1Distance"))
+            config.lod1Distance = (uint32_t) (int32_t) cfg.lookup("lod1Distance");
+        if (cfg.exists("lod2Distance"))
+            config.lod2Distance = (uint32_t) (int32_t) cfg.lookup("lod2Distance");
+        if (cfg.exists("horizonDistance"))
+            config.horizonDistance = (uint32_t) (int32_t) cfg.lookup("horizonDistance");
+        if (cfg.exists("sortTranslucentFaces"))
+            config.sortTranslucentFaces = cfg.lookup("sortTranslucentFaces");
+        if (cfg.exists("meshCacheMB"))
+            config.meshCacheMB = (uint32_t) (int32_t) cfg.lookup("meshCacheMB");
+        if (cfg.exists("meshCacheFile"))
+            config.meshCacheFile = (const char*) cfg.lookup("meshCacheFile");
+        if (cfg.exists("meshCacheFileMB"))
+            config.meshCacheFileMB = (uint32_t) (int32_t) cfg.lookup("meshCacheFileMB");
     }
     catch (libconfig::SettingTypeException& e)
     {
@@ -59,6 +87,12 @@ bool loadConfig(const char* path, GameConfig& config)
         config.loadDistance = config.renderDistance;
     }
 
+    if (config.lod1Distance > 0 && config.lod2Distance > 0 && config.lod2Distance <= config.lod1Distance)
+    {
+        LOG_WARN("Config warning: lod2Distance is not greater than lod1Distance. The 4x level is turned off.");
+        config.lod2Distance = 0;
+    }
+
     if (config.threadCount > std::thread::hardware_concurrency())
         LOG_WARN("Config warning: threadCount is less than the number of CPU cores. It's capped to {}.", std::thread::hardware_concurrency());
 
@@ -82,6 +116,20 @@ bool createConfigFile(const char* path, const GameConfig& config)
     root.add("maxBakesPerFrame", Setting::TypeInt) = (int32_t) config.maxBakesPerFrame;
     root.add("worldSeed", Setting::TypeInt) = (int32_t) config.worldSeed;
     root.add("reachDistance", Setting::TypeFloat) = config.reachDistance;
+    root.add("compactionThreshold", Setting::TypeInt) = (int32_t) config.compactionThreshold;
+    root.add("autosaveInterval", Setting::TypeFloat) = config.autosaveInterval;
+    root.add("frameBudgetMs", Setting::TypeFloat) = config.frameBudgetMs;
+    root.add("dynamicRenderDistance", Setting::TypeBoolean) = config.dynamicRenderDistance;
+    root.add("minRenderDistance", Setting::TypeInt) = (int32_t) config.minRenderDistance;
+    root.add("uploadBudgetKB", Setting::TypeInt) = (int32_t) config.uploadBudgetKB;
+    root.add("uploadThread", Setting::TypeBoolean) = config.uploadThread;
+    root.add("lod1Distance", Setting::TypeInt) = (int32_t) config.lod1Distance;
+    root.add("lod2Distance", Setting::TypeInt) = (int32_t) config.lod2Distance;
+    root.add("horizonDistance", Setting::TypeInt) = (int32_t) config.horizonDistance;
+    root.add("sortTranslucentFaces", Setting::TypeBoolean) = config.sortTranslucentFaces;
+    root.add("meshCacheMB", Setting::TypeInt) = (int32_t) config.meshCacheMB;
+    root.add("meshCacheFile", Setting::TypeString) = config.meshCacheFile.c_str();
+    root.add("meshCacheFileMB", Setting::TypeInt) = (int32_t) config.meshCacheFileMB;
 
     try
     {
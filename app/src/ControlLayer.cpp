@@ -1,6 +1,7 @@
 #include "ControlLayer.h"
 #include "Application.h"
 #include "MenuLayer.h"
+#include "Trace.h"
 
 bool ControlLayer::onEvent(core::Event& e)
 {
@@ -12,6 +13,14 @@ bool ControlLayer::onEvent(core::Event& e)
             core::Application::get().toggleLayer("DebugLayer");
         return true;
     }
+    if (e.keyEvent.key == GLFW_KEY_F4)
+    {
+        if (isTraceRecording())
+            stopTraceRecording(TRACE_PATH);
+        else
+            startTraceRecording();
+        return true;
+    }
     if (e.keyEvent.key == GLFW_KEY_ESCAPE)
     {
         if (core::Application::get().getLayer("MenuLayer"))
@@ -1,10 +1,10 @@
 #include "DebugLayer.h"
-#include <ranges>
 #include "Application.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 #include "OpenGLHelper.h"
 #include "implot.h"
+#include "MeshCache.h"
 
 VertexArray createAxesVAO();
 
@@ -87,9 +87,67 @@ void DebugLayer::drawMenu(GameLayer* gameLayer) const
 
     const GameConfig gameConfig = gameLayer->m_GameConfig;
     ImGui::Text("Seed: %d", gameConfig.worldSeed);
-    ImGui::Text("Render Distance: %d", gameConfig.renderDistance);
+    ImGui::Text("Render Distance: %d (effective %d%s)", gameConfig.renderDistance, gameLayer->m_ChunkManager.renderDistance,
+                gameConfig.dynamicRenderDistance ? ", dynamic" : "");
     ImGui::Text("Load Distance: %d", gameConfig.loadDistance);
     ImGui::Text("Threads: %d", gameConfig.threadCount);
+    ImGui::Text("Chunks: %zu (%u drawn)", gameLayer->m_ChunkManager.chunks.size(), gameLayer->m_DrawnChunks);
+    ImGui::Spacing();ImGui::Spacing();
+
+    const StreamingScheduler& scheduler = gameLayer->m_Scheduler;
+    ImGui::Text("Streaming: %.2f / %.2f ms (frame budget %.1f ms, other work %.2f ms)",
+                scheduler.streamingMs, scheduler.streamingBudgetMs, scheduler.frameBudgetMs, scheduler.otherWorkMs);
+    for (uint32_t i = 0; i < STREAM_STAGE_COUNT; i++)
+    {
+        ImGui::Text("%-8s quota %3u / %3u  %.3f ms per chunk  %.2f ms", STREAM_STAGE_NAMES[i],
+                    scheduler.quotas[i], scheduler.maxQuotas[i], scheduler.costPerItemMs[i], scheduler.stageMs[i]);
+    }
+    const ChunkManager& chunkManager = gameLayer->m_ChunkManager;
+    ImGui::Text("Jobs: %zu loads, %zu meshes pending, %llu dropped, %llu wasted (%.1f ms)",
+                chunkManager.pendingLoads.size(), chunkManager.pendingMeshes.size(),
+                (unsigned long long) chunkManager.threadPool.droppedJobs.load(), (unsigned long long) chunkManager.wastedJobs, chunkManager.wastedJobMs);
+    ImGui::Text("Light: %zu jobs pending, %zu chunks waiting, %llu edits relit %llu voxels in %.1f ms, last %u in %.3f ms",
+                chunkManager.pendingLights.size(), chunkManager.lightQueue.size(), (unsigned long long) chunkManager.relights,
+                (unsigned long long) chunkManager.relitVoxels, chunkManager.relightMs, chunkManager.lastRelitVoxels, chunkManager.lastRelightMs);
+    ImGui::Text("Meshes: %llu built for %llu chunks (%.2f per chunk)", (unsigned long long) chunkManager.meshesBuilt,
+                (unsigned long long) chunkManager.chunksWithMesh,
+                chunkManager.chunksWithMesh > 0 ? double(chunkManager.meshesBuilt) / double(chunkManager.chunksWithMesh) : 0.0);
+    ImGui::Text("Mesh Buffers: %zu pooled, %llu reused, %llu deleted", chunkManager.meshBuffers.released.size(),
+                (unsigned long long) chunkManager.meshBuffers.reused, (unsigned long long) chunkManager.meshBuffers.deleted);
+    if (chunkManager.meshUploader)
+        ImGui::Text("Uploads: upload thread, %zu in flight", chunkManager.pendingUploads.size());
+    else
+        ImGui::Text("Uploads: %zu queued, %.0f / %u KB uploaded", chunkManager.uploadQueue.size(),
+                    double(chunkManager.uploadedBytes) / 1024.0, chunkManager.config.uploadBudgetKB);
+    const uint64_t opaqueFaces = chunkManager.drawnFaces + chunkManager.skippedFaces;
+    ImGui::Text("Back-face rejection: %llu / %llu opaque faces skipped (%.0f%%)", (unsigned long long) chunkManager.skippedFaces,
+                (unsigned long long) opaqueFaces, opaqueFaces > 0 ? 100.0 * double(chunkManager.skippedFaces) / double(opaqueFaces) : 0.0);
+    ImGui::Text("Translucent sorts: %llu uploaded, %llu kept their order", (unsigned long long) chunkManager.sortsUploaded,
+                (unsigned long long) chunkManager.sortsKept);
+    if (const MeshCache* meshCache = chunkManager.meshCache.get())
+    {
+        const uint64_t lookups = chunkManager.meshCacheHits + chunkManager.meshCacheMisses;
+        ImGui::Text("Mesh cache: %.0f%% hits (%llu / %llu, %llu from file), %.1f ms saved, %.1f / %u MB",
+                    lookups > 0 ? 100.0 * double(chunkManager.meshCacheHits) / double(lookups) : 0.0,
+                    (unsigned long long) chunkManager.meshCacheHits, (unsigned long long) lookups,
+                    (unsigned long long) meshCache->fileHits.load(), chunkManager.meshCacheSavedMs,
+                    double(getMemoryUsage(MESH_CACHE).bytes) / (1024.0 * 1024.0), gameConfig.meshCacheMB);
+    }
+    const HorizonTerrain& horizon = gameLayer->m_Horizon;
+    ImGui::Text("Horizon: %d chunks, %u / %zu tiles uploaded", gameConfig.horizonDistance, horizon.uploadedTiles, horizon.tiles.size());
+    ImGui::Text("LOD: %d / %d chunks", gameConfig.lod1Distance, gameConfig.lod2Distance);
+    for (uint32_t lod = 0; lod < ChunkManager::LOD_COUNT; lod++)
+    {
+        ImGui::Text("  %ux  %5u chunks  %9llu faces", 1u << lod, chunkManager.drawnPerLod[lod],
+                    (unsigned long long) chunkManager.facesPerLod[lod]);
+    }
+    ImGui::Spacing();ImGui::Spacing();
+
+    for (uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; i++)
+    {
+        const MemoryUsage usage = getMemoryUsage(MEMORY_CATEGORY(i));
+        ImGui::Text("%-14s %8.2f MB  %7lld objects", MEMORY_CATEGORY_NAMES[i], double(usage.bytes) / (1024.0 * 1024.0), (long long) usage.objects);
+    }
     ImGui::Spacing();ImGui::Spacing();
 
     ImGui::Checkbox("Player Physics", &gameLayer->m_PlayerPhysicsOn);
@@ -103,30 +161,40 @@ void DebugLayer::drawMenu(GameLayer* gameLayer) const
     ImPlot::BeginPlot("Profiling metrics");
     ImPlot::SetupAxes("Sample", "Frame Time (ms)");
 
+    const size_t metricCount = getMetricCount();
     double maxFrameTimeMs = 0;
-    for (auto& data : metrics | std::views::values)
+    for (MetricID id = 0; id < metricCount; id++)
     {
-        for (auto& val : data.values)
+        for (auto& val : getMetric(id).values)
             maxFrameTimeMs = std::max(maxFrameTimeMs, val);
     }
 
     ImPlot::SetupAxisLimits(ImAxis_Y1, 0.0, maxFrameTimeMs, ImGuiCond_Always);
     ImPlot::SetupAxisLimits(ImAxis_X1, 0, SAMPLE_COUNT, ImGuiCond_Always);
 
-    for (auto& [name, data] : metrics)
+    for (MetricID id = 0; id < metricCount; id++)
     {
+        auto& data = getMetric(id);
         std::array<float, SAMPLE_COUNT> frameTimesMs;
         size_t i = 0;
         for (const auto& val : data.values)
             frameTimesMs[i++] = val;
 
         ImPlot::PushStyleColor(ImPlotCol_Line, data.color);
-        ImPlot::PlotLine(name.c_str(), frameTimesMs.data(), i);
+        ImPlot::PlotLine(data.name, frameTimesMs.data(), i);
         ImPlot::PopStyleColor();
     }
 
     ImPlot::EndPlot();
 
+    ImGui::Text("%-24s %8s %8s %8s %8s", "Metric (ms)", "p50", "p95", "p99", "max");
+    for (MetricID id = 0; id < metricCount; id++)
+    {
+        auto& data = getMetric(id);
+        const MetricSummary summary = summarizeMetric(data);
+        ImGui::TextColored(data.color, "%-24s %8.3f %8.3f %8.3f %8.3f", data.name, summary.p50, summary.p95, summary.p99, summary.max);
+    }
+
 #endif
 
     ImGui::End();
@@ -17,22 +17,29 @@
 #include "Config.h"
 
 static glm::vec3 moveInput(const Window& window, const glm::vec3& lookDir);
-static void placeBlock(ChunkManager& chunkManager, Camera& cam, BLOCK_TYPE block, SQLite::Database& db, float reachDistance);
+static void placeBlock(ChunkManager& chunkManager, Camera& cam, BLOCK_TYPE block, float reachDistance);
 
 #define m_Window core::Application::get().getWindow()
 
 GameLayer::GameLayer(const std::string& name, const GameConfig& gameConfig)
     :   Layer(name),
         m_GameConfig(gameConfig),
-        m_Cam(glm::vec3{0, WorldGenerationData::MAX_HEIGHT + 2, 0}, 90.0f, m_Window.getSettings().width, m_Window.getSettings().height, 0.1f, gameConfig.renderDistance * Chunk::CHUNK_SIZE * 4),
+        m_Cam(glm::vec3{0, WorldGenerationData::MAX_HEIGHT + 2, 0}, 90.0f, m_Window.getSettings().width, m_Window.getSettings().height, 0.1f, glm::max(gameConfig.renderDistance, gameConfig.horizonDistance) * Chunk::CHUNK_SIZE * 4),
         m_ChunkManager(gameConfig),
+        m_Horizon(gameConfig, m_ChunkManager.threadPool),
+        m_Scheduler(gameConfig),
+        m_RenderDistanceController(gameConfig),
         m_Database(initDB(gameConfig.saveGamePath)),
+        m_WorldSaver(gameConfig.saveGamePath, gameConfig.compactionThreshold, gameConfig.worldSeed),
         m_PlayerPhysics(BoundingBox{m_Cam.position, glm::vec3{1, 2, 1}}, glm::vec3(0.0f)), m_PrevCursorPos(m_Window.getMousePosition()), selectedBlock(BLOCK_TYPE::INVALID),
         m_CamSpeed(50.0f),
         m_Exposure(0.8f),
         m_PlayerPhysicsOn(true)
 {
     m_Window.disableCursor();
+    m_ChunkManager.focus.position = m_Cam.position;
+    if (gameConfig.uploadThread)
+        m_ChunkManager.startUploadThread(m_Window.createSharedContext());
 
     const EntityBehavior noBehavior;
     m_EntityManager.addEntity(BoundingBox{
@@ -65,15 +72,38 @@ GameLayer::GameLayer(const std::string& name, const GameConfig& gameConfig)
                               noBehavior);
 }
 
+GameLayer::~GameLayer()
+{
+    // the saver writes everything that is queued before its thread stops
+    m_WorldSaver.queueSnapshots(m_ChunkManager.snapshotDirtyChunks());
+}
+
 void GameLayer::onUpdate(const double dt)
 {
+    mergeMetricSamples();
+    m_Scheduler.beginFrame();
+
+    if (m_GameConfig.dynamicRenderDistance)
+        m_ChunkManager.renderDistance = m_RenderDistanceController.update(dt * 1000.0, m_Scheduler.frameWorkMs, m_DrawnChunks);
+
     CAPTURE("Game Update",
         const auto chunkPos = worldPosToChunkPos(m_PlayerPhysics.box.pos);
 
+        // snapshots are taken at the frame boundary, serialising happens on the saver thread
+        m_TimeSinceAutosave += dt;
+        if (m_TimeSinceAutosave >= m_GameConfig.autosaveInterval)
+        {
+            m_TimeSinceAutosave = 0.0;
+            CAPTURE("Autosave", m_WorldSaver.queueSnapshots(m_ChunkManager.snapshotDirtyChunks()));
+        }
+
         CAPTURE("Update Entities", m_EntityManager.updateEntities(dt, m_ChunkManager));
-        CAPTURE("Chunk Unloading", m_ChunkManager.unloadChunks(chunkPos));
-        CAPTURE("Chunk Loading", m_ChunkManager.loadChunks(chunkPos, m_Database));
-        CAPTURE("Chunk Baking", m_ChunkManager.bakeChunks(chunkPos));
+        CAPTURE("Chunk Unloading", m_Scheduler.run(STREAM_UNLOAD, [&](const uint32_t quota) { return m_ChunkManager.unloadChunks(chunkPos, m_WorldSaver, quota); }));
+        CAPTURE("Chunk Loading", m_Scheduler.run(STREAM_LOAD, [&](const uint32_t quota) { return m_ChunkManager.loadChunks(chunkPos, m_Database, m_WorldSaver, quota); }));
+        CAPTURE("Chunk Meshing", m_Scheduler.run(STREAM_MESH, [&](const uint32_t quota) { return m_ChunkManager.meshChunks(chunkPos, quota); }));
+        CAPTURE("Chunk Upload", m_Scheduler.run(STREAM_UPLOAD, [&](const uint32_t quota) { return m_ChunkManager.uploadMeshes(quota); }));
+        CAPTURE("Translucent Sorting", m_ChunkManager.sortTranslucentFaces(m_Cam.position));
+        CAPTURE("Horizon Update", m_Horizon.update(chunkPos, m_ChunkManager.renderDistance));
 
         glm::vec3 in = moveInput(m_Window, m_Cam.lookDir);
         if (m_PlayerPhysicsOn)
@@ -97,25 +127,40 @@ void GameLayer::onUpdate(const double dt)
         }
         m_Cam.updateView();
     );
+
+    // measured from the camera since physics and free flight move it differently
+    if (dt > 0.0)
+    {
+        const glm::vec3 velocity = (m_Cam.position - m_ChunkManager.focus.position) / (float) dt;
+        m_ChunkManager.focus = {m_Cam.position, glm::mix(m_ChunkManager.focus.velocity, velocity, 0.2f), m_Cam.lookDir};
+    }
+
+    m_Scheduler.endUpdate();
 }
 
 void GameLayer::onRender()
 {
+    m_Scheduler.beginRender();
+
     CAPTURE("Game Render",
         const float skyExposure = 0.5f + 0.5f * m_Exposure;
 
         m_Renderer.clearFrame(skyExposure);
-        CAPTURE("Chunk Drawing", m_ChunkManager.drawChunks(m_Renderer, m_Cam.viewProjection, m_Exposure));
+        m_Renderer.beginFrame(m_Cam.viewProjection, m_Exposure);
+        CAPTURE("Chunk Drawing", m_DrawnChunks = m_ChunkManager.drawChunks(m_Renderer, m_Cam.position));
+        CAPTURE("Horizon Drawing", m_Horizon.draw(m_Renderer));
 
         const RaycastResult res = raycast(m_Cam.position - m_Cam.lookDir, m_Cam.lookDir, m_GameConfig.reachDistance, m_ChunkManager);
         if (res.hit)
-            m_Renderer.drawHighlightBlock(res.pos, m_Cam.viewProjection, m_Exposure);
+            m_Renderer.drawHighlightBlock(res.pos);
 
         CAPTURE("Draw Entities", m_EntityManager.drawEntities(m_Renderer, m_Cam.viewProjection, m_Exposure));
 
         //static auto entityModel = createEntityWireframe(m_PlayerPhysics.box.size);
         //m_Renderer.drawEntity(entityModel, m_PlayerPhysics.box.pos, m_Cam.viewProjection, exposure);
     );
+
+    m_Scheduler.endRender();
 }
 
 bool GameLayer::keyPressCallback(const core::Event& e)
@@ -146,7 +191,7 @@ bool GameLayer::mousePressedCallback(const core::Event& e)
 
     if (e.mouseEvent.button == GLFW_MOUSE_BUTTON_LEFT)
     {
-        placeBlock(m_ChunkManager, m_Cam, selectedBlock, m_Database, m_GameConfig.reachDistance);
+        placeBlock(m_ChunkManager, m_Cam, selectedBlock, m_GameConfig.reachDistance);
         return true;
     }
 
@@ -166,7 +211,7 @@ bool GameLayer::onEvent(core::Event& e)
     }
 }
 
-void placeBlock(ChunkManager& chunkManager, Camera& cam, BLOCK_TYPE block, SQLite::Database& db, float reachDistance)
+void placeBlock(ChunkManager& chunkManager, Camera& cam, BLOCK_TYPE block, const float reachDistance)
 {
     if (block == BLOCK_TYPE::INVALID)
     {
@@ -182,11 +227,9 @@ void placeBlock(ChunkManager& chunkManager, Camera& cam, BLOCK_TYPE block, SQLit
 
     const glm::ivec3& chunkPos = res.chunk->chunkPosition;
 
-    std::string stmt;
     if (block == BLOCK_TYPE::AIR)
     {
-        res.chunk->setBlockUnsafe(positionInChunk, BLOCK_TYPE::AIR);
-        saveBlockChanges(db, chunkPos, positionInChunk, BLOCK_TYPE::AIR);
+        chunkManager.setBlock(*res.chunk, positionInChunk, BLOCK_TYPE::AIR);
     }
     else
     {
@@ -206,8 +249,7 @@ void placeBlock(ChunkManager& chunkManager, Camera& cam, BLOCK_TYPE block, SQLit
 
         if (isChunkCoord(neighbourBlockPos))
         {
-            res.chunk->setBlockUnsafe(neighbourBlockPos, block);
-            saveBlockChanges(db, chunkPos, neighbourBlockPos, block);
+            chunkManager.setBlock(*res.chunk, neighbourBlockPos, block);
         }
         else
         {
@@ -220,43 +262,9 @@ void placeBlock(ChunkManager& chunkManager, Camera& cam, BLOCK_TYPE block, SQLit
             assert(neighbourChunk != nullptr);
             assert(neighbourChunk->getBlockSafe(blockPosInOtherChunk) != BLOCK_TYPE::INVALID);
 
-            neighbourChunk->setBlockUnsafe(blockPosInOtherChunk, block);
-            saveBlockChanges(db, neighbourChunk->chunkPosition, neighbourBlockPos, block);
+            chunkManager.setBlock(*neighbourChunk, blockPosInOtherChunk, block);
         }
     }
-
-    db.exec(stmt);
-
-    if (positionInChunk.x == 0)
-    {
-        Chunk* chunk = chunkManager.getChunk({chunkPos.x - 1, chunkPos.y, chunkPos.z});
-        if (chunk) chunk->isMeshBaked = false;
-    }
-    else if (positionInChunk.x == Chunk::CHUNK_SIZE - 1)
-    {
-        Chunk* chunk = chunkManager.getChunk({chunkPos.x + 1, chunkPos.y, chunkPos.z});
-        if (chunk) chunk->isMeshBaked = false;
-    }
-    if (positionInChunk.y == 0)
-    {
-        Chunk* chunk = chunkManager.getChunk({chunkPos.x, chunkPos.y - 1, chunkPos.z});
-        if (chunk) chunk->isMeshBaked = false;
-    }
-    else if (positionInChunk.y == Chunk::CHUNK_SIZE - 1)
-    {
-        Chunk* chunk = chunkManager.getChunk({chunkPos.x, chunkPos.y + 1, chunkPos.z});
-        if (chunk) chunk->isMeshBaked = false;
-    }
-    if (positionInChunk.z == 0)
-    {
-        Chunk* chunk = chunkManager.getChunk({chunkPos.x, chunkPos.y, chunkPos.z - 1});
-        if (chunk) chunk->isMeshBaked = false;
-    }
-    else if (positionInChunk.z == Chunk::CHUNK_SIZE - 1)
-    {
-        Chunk* chunk = chunkManager.getChunk({chunkPos.x, chunkPos.y, chunkPos.z + 1});
-        if (chunk) chunk->isMeshBaked = false;
-    }
 }
 
 glm::vec3 moveInput(const Window& window, const glm::vec3& lookDir)
@@ -4,13 +4,14 @@
 #include "glm/exponential.hpp"
 #include "glm/trigonometric.hpp"
 #include "FastNoiseLite.h"
+#include "SQLiteCpp/Statement.h"
+#include "SQLiteCpp/Transaction.h"
 
 FastNoiseLite genPrimNoise(uint32_t seed);
 FastNoiseLite genSecNoise(uint32_t seed);
 FastNoiseLite genBiomeNoise(uint32_t seed);
 FastNoiseLite genTreeNoise(uint32_t seed);
 FastNoiseLite genForestNoise(uint32_t seed);
-uint32_t noiseToHeight(float primaryValue, float secondaryValue, float biomeValue);
 
 SQLite::Database initDB(const std::string& dbPath)
 {
@@ -25,29 +26,77 @@ SQLite::Database initDB(const std::string& dbPath)
         "blockType INTEGER,"
         "PRIMARY KEY (chunkX, chunkY, chunkZ, x, y, z))";
 
-    SQLite::Database db(dbPath, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+    const std::string DIFF_TABLE =
+        "ChunkDiff("
+        "chunkX INTEGER,"
+        "chunkY INTEGER,"
+        "chunkZ INTEGER,"
+        "diff BLOB,"
+        "PRIMARY KEY (chunkX, chunkY, chunkZ))";
+
+    // the compactor writes through its own connection, wait for its lock instead of failing
+    constexpr int BUSY_TIMEOUT_MS = 1000;
+    SQLite::Database db(dbPath, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE, BUSY_TIMEOUT_MS);
+    db.exec("PRAGMA journal_mode=WAL");
     db.exec("CREATE TABLE IF NOT EXISTS " + DB_TABLE);
+    db.exec("CREATE TABLE IF NOT EXISTS " + DIFF_TABLE);
     return db;
 }
 
-void saveBlockChanges(SQLite::Database& db, const glm::ivec3& chunkPos, const glm::ivec3& positionInChunk, BLOCK_TYPE blockType)
+// diff blob: one entry per changed voxel, 2 bytes block index (little endian) + 1 byte block type
+constexpr size_t DIFF_ENTRY_SIZE = 3;
+
+static std::vector<uint8_t> encodeBlockDiff(const std::vector<BLOCK_TYPE>& changes)
 {
-    assert(isChunkCoord(positionInChunk));
-    const std::string stmt = std::format("INSERT OR REPLACE INTO BlockChange VALUES({}, {}, {}, {}, {}, {}, {})",
-        chunkPos.x, chunkPos.y, chunkPos.z, positionInChunk.x, positionInChunk.y, positionInChunk.z, (int) blockType);
+    std::vector<uint8_t> diff;
+    for (uint32_t i = 0; i < changes.size(); i++)
+    {
+        if (changes[i] == BLOCK_TYPE::INVALID)
+            continue;
 
-    db.exec(stmt);
+        diff.push_back(uint8_t(i & 0xFF));
+        diff.push_back(uint8_t(i >> 8));
+        diff.push_back(uint8_t(changes[i]));
+    }
+
+    return diff;
 }
 
-std::vector<BlockChange> getBlockChangesForChunk(SQLite::Database& db, const glm::ivec3& chunkPos)
+static void decodeBlockDiff(const uint8_t* diff, const size_t size, std::vector<BlockChange>& changes)
+{
+    changes.reserve(changes.size() + size / DIFF_ENTRY_SIZE);
+    for (size_t i = 0; i + DIFF_ENTRY_SIZE <= size; i += DIFF_ENTRY_SIZE)
+    {
+        const int32_t index = diff[i] | (diff[i + 1] << 8);
+        const glm::ivec3 pos{
+            index % Chunk::CHUNK_SIZE,
+            (index / Chunk::CHUNK_SIZE) % Chunk::CHUNK_SIZE,
+            index / (Chunk::CHUNK_SIZE * Chunk::CHUNK_SIZE)
+        };
+        changes.emplace_back(pos, (BLOCK_TYPE) diff[i + 2]);
+    }
+}
+
+static std::vector<BlockChange> readBlockChanges(SQLite::Database& db, const glm::ivec3& chunkPos)
 {
+    std::vector<BlockChange> changes;
+
+    SQLite::Statement diffQuery(db, "SELECT diff FROM ChunkDiff WHERE chunkX = ? AND chunkY = ? AND chunkZ = ?");
+    diffQuery.bind(1, chunkPos.x);
+    diffQuery.bind(2, chunkPos.y);
+    diffQuery.bind(3, chunkPos.z);
+    if (diffQuery.executeStep())
+    {
+        const SQLite::Column diff = diffQuery.getColumn(0);
+        decodeBlockDiff(static_cast<const uint8_t*>(diff.getBlob()), diff.getBytes(), changes);
+    }
+
     SQLite::Statement query(db, "SELECT x, y, z, blockType FROM BlockChange WHERE chunkX = ? AND chunkY = ? AND chunkZ = ?");
 
     query.bind(1, chunkPos.x);
     query.bind(2, chunkPos.y);
     query.bind(3, chunkPos.z);
 
-    std::vector<BlockChange> changes;
     while (query.executeStep())
     {
         int x = query.getColumn(0).getInt();
@@ -61,6 +110,80 @@ std::vector<BlockChange> getBlockChangesForChunk(SQLite::Database& db, const glm
     return changes;
 }
 
+std::vector<BlockChange> getBlockChangesForChunk(SQLite::Database& db, const glm::ivec3& chunkPos)
+{
+    // diff and journal have to come from the same snapshot, a compaction could commit in between otherwise
+    SQLite::Transaction transaction(db);
+    auto changes = readBlockChanges(db, chunkPos);
+    transaction.commit();
+
+    return changes;
+}
+
+static void writeChunkDiff(SQLite::Database& db, const glm::ivec3& chunkPos, const std::vector<uint8_t>& diff)
+{
+    if (diff.empty())
+    {
+        SQLite::Statement erase(db, "DELETE FROM ChunkDiff WHERE chunkX = ? AND chunkY = ? AND chunkZ = ?");
+        erase.bind(1, chunkPos.x);
+        erase.bind(2, chunkPos.y);
+        erase.bind(3, chunkPos.z);
+        erase.exec();
+    }
+    else
+    {
+        SQLite::Statement insert(db, "INSERT OR REPLACE INTO ChunkDiff VALUES(?, ?, ?, ?)");
+        insert.bind(1, chunkPos.x);
+        insert.bind(2, chunkPos.y);
+        insert.bind(3, chunkPos.z);
+        insert.bind(4, diff.data(), int(diff.size()));
+        insert.exec();
+    }
+
+    SQLite::Statement erase(db, "DELETE FROM BlockChange WHERE chunkX = ? AND chunkY = ? AND chunkZ = ?");
+    erase.bind(1, chunkPos.x);
+    erase.bind(2, chunkPos.y);
+    erase.bind(3, chunkPos.z);
+    erase.exec();
+}
+
+bool compactBlockChanges(SQLite::Database& db, const glm::ivec3& chunkPos, const uint32_t threshold)
+{
+    // take the write lock up front so no journal row can be added between reading and deleting
+    SQLite::Transaction transaction(db, SQLite::TransactionBehavior::IMMEDIATE);
+
+    {
+        SQLite::Statement countQuery(db, "SELECT COUNT(*) FROM BlockChange WHERE chunkX = ? AND chunkY = ? AND chunkZ = ?");
+        countQuery.bind(1, chunkPos.x);
+        countQuery.bind(2, chunkPos.y);
+        countQuery.bind(3, chunkPos.z);
+        if (!countQuery.executeStep() || countQuery.getColumn(0).getInt() < int(threshold))
+            return false;
+    }
+
+    // later changes overwrite earlier ones
+    std::vector<BLOCK_TYPE> changes(Chunk::BLOCKS_PER_CHUNK, BLOCK_TYPE::INVALID);
+    for (const auto& [pos, blockType] : readBlockChanges(db, chunkPos))
+    {
+        if (isChunkCoord(pos))
+            changes[pos.x + pos.y * Chunk::CHUNK_SIZE + pos.z * Chunk::CHUNK_SIZE * Chunk::CHUNK_SIZE] = blockType;
+    }
+
+    writeChunkDiff(db, chunkPos, encodeBlockDiff(changes));
+    transaction.commit();
+    return true;
+}
+
+void saveChunkDiff(SQLite::Database& db, const glm::ivec3& chunkPos, const std::vector<BLOCK_TYPE>& changes)
+{
+    assert(changes.size() == Chunk::BLOCKS_PER_CHUNK);
+    const std::vector<uint8_t> diff = encodeBlockDiff(changes);
+
+    SQLite::Transaction transaction(db, SQLite::TransactionBehavior::IMMEDIATE);
+    writeChunkDiff(db, chunkPos, diff);
+    transaction.commit();
+}
+
 WorldGenerationData::WorldGenerationData(uint32_t seed)
         :   treeNoise(genTreeNoise(seed)),
             forestNoise(genForestNoise(seed)),
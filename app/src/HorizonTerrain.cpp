@@ -0,0 +1,242 @@
+#include "HorizonTerrain.h"
+#include "OpenGLHelper.h"
+#include "Rendering.h"
+#include "cstmlib/Profiling.h"
+#include "glm/common.hpp"
+#include "glm/geometric.hpp"
+
+// tiles are queued behind every chunk job, chunk priorities stay far below this
+constexpr float HORIZON_PRIORITY = 1e6f;
+
+static uint32_t packHorizonColor(const glm::vec3& color, const float lighting)
+{
+    const glm::uvec3 rgb = glm::uvec3(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+    const auto light = uint32_t(glm::clamp(lighting * 0.5f, 0.0f, 1.0f) * 255.0f + 0.5f);
+    return rgb.r | rgb.g << 8 | rgb.b << 16 | light << 24;
+}
+
+void generateHorizonTile(const WorldGenerationData& worldGenData, const glm::ivec2& tilePos, std::vector<HorizonVertex>& vertices)
+{
+    using H = HorizonTerrain;
+    // one extra sample around the tile for the normals at its edges
+    constexpr int32_t SAMPLES = H::TILE_CELLS + 3;
+    std::array<float, SAMPLES * SAMPLES> heights;
+    const glm::ivec2 origin = tilePos * H::TILE_BLOCKS;
+    for (int32_t z = 0; z < SAMPLES; z++)
+        for (int32_t x = 0; x < SAMPLES; x++)
+            heights[z * SAMPLES + x] = float(worldGenData.getHeightAt(origin + (glm::ivec2{x, z} - 1) * H::CELL_BLOCKS));
+
+    // same light as the FrameData block of the renderer, baked per vertex
+    const glm::vec3 lightDirection(LIGHT_DIRECTION);
+    vertices.resize(H::TILE_VERTICES);
+    for (int32_t z = 0; z <= H::TILE_CELLS; z++)
+    {
+        for (int32_t x = 0; x <= H::TILE_CELLS; x++)
+        {
+            const auto height = [&](const int32_t dx, const int32_t dz) { return heights[(z + 1 + dz) * SAMPLES + x + 1 + dx]; };
+            const float terrainHeight = height(0, 0);
+            const glm::ivec2 pos = origin + glm::ivec2{x, z} * H::CELL_BLOCKS;
+
+            // the surface blocks of generateTerrain, water fills up to the sea level
+            glm::vec3 normal{0.0f, 1.0f, 0.0f}, color;
+            float surfaceHeight = terrainHeight;
+            if (terrainHeight <= float(WorldGenerationData::SEA_LEVEL))
+            {
+                color = {0.22f, 0.38f, 0.72f};
+                surfaceHeight = float(WorldGenerationData::SEA_LEVEL + 1);
+            }
+            else
+            {
+                normal = glm::normalize(glm::vec3{height(-1, 0) - height(1, 0), 2.0f * H::CELL_BLOCKS, height(0, -1) - height(0, 1)});
+                if (terrainHeight < float(WorldGenerationData::SEA_LEVEL + 3))
+                    color = {0.86f, 0.81f, 0.58f};
+                else if (terrainHeight < float(WorldGenerationData::SEA_LEVEL + 5))
+                    color = {0.5f, 0.5f, 0.5f};
+                else if (worldGenData.isForest(pos))
+                    color = {0.2f, 0.42f, 0.16f};
+                else
+                    color = {0.38f, 0.62f, 0.26f};
+            }
+
+            const float lighting = LIGHT_COLOR.w + glm::max(0.0f, glm::dot(lightDirection, normal)) * LIGHT_COLOR.r;
+            vertices[z * (H::TILE_CELLS + 1) + x] = {glm::vec3{float(pos.x), surfaceHeight, float(pos.y)}, packHorizonColor(color, lighting)};
+        }
+    }
+}
+
+HorizonTerrain::HorizonTerrain(const GameConfig& config, ThreadPool& threadPool)
+    :   config(config), threadPool(threadPool),
+        worldGenData(std::make_shared<const WorldGenerationData>(config.worldSeed)),
+        results(std::make_shared<Results>())
+{
+}
+
+HorizonTerrain::~HorizonTerrain()
+{
+    for (auto& [_, tile] : tiles)
+        tile.token->store(true);
+}
+
+void HorizonTerrain::createBuffers()
+{
+    const auto horizonTiles = int32_t(2 * glm::max(config.horizonDistance, 1u) / TILE_CHUNKS + 2);
+    const int32_t slotCount = horizonTiles * horizonTiles;
+    const auto vertexBytes = int64_t(slotCount) * TILE_VERTICES * sizeof(HorizonVertex);
+
+    VertexBufferLayout layout;
+    layout.pushFloat(3);
+    layout.pushUInt(1);
+    vao.addBuffer(createBuffer(nullptr, GLsizei(vertexBytes), GL_ARRAY_BUFFER, GL_DYNAMIC_DRAW), layout);
+
+    std::vector<uint16_t> indices;
+    indices.reserve(TILE_INDICES);
+    for (int32_t z = 0; z < TILE_CELLS; z++)
+    {
+        for (int32_t x = 0; x < TILE_CELLS; x++)
+        {
+            const auto i = uint16_t(z * (TILE_CELLS + 1) + x);
+            const auto below = uint16_t(i + TILE_CELLS + 1);
+            indices.insert(indices.end(), {i, below, uint16_t(i + 1), uint16_t(i + 1), below, uint16_t(below + 1)});
+        }
+    }
+
+    // the vertex array is still bound, so it keeps the index buffer and deletes it with the rest
+    vao.buffers.push_back(createBuffer(indices.data(), GLsizei(indices.size() * sizeof(uint16_t)), GL_ELEMENT_ARRAY_BUFFER));
+    vao.unbind();
+    vao.vertexCount = TILE_INDICES;
+    gpuMemory.set(vertexBytes + int64_t(indices.size() * sizeof(uint16_t)), 2);
+
+    for (int32_t slot = slotCount - 1; slot >= 0; slot--)
+        freeSlots.push_back(slot);
+}
+
+void HorizonTerrain::updateTiles(const glm::ivec3& currChunkPos, const int32_t render)
+{
+    hasCenter = true;
+    center = currChunkPos;
+    renderRadius = render;
+
+    const auto horizon = int32_t(config.horizonDistance);
+    const glm::ivec2 centerChunk{currChunkPos.x, currChunkPos.z};
+    const auto toTile = [](const glm::ivec2& chunkPos) { return glm::ivec2(glm::floor(glm::vec2(chunkPos) / float(TILE_CHUNKS))); };
+    const glm::ivec2 minTile = toTile(centerChunk - horizon), maxTile = toTile(centerChunk + horizon);
+
+    // tiles completely covered by the render cube would never show
+    const auto isNeeded = [&](const glm::ivec2& tilePos)
+    {
+        if (glm::any(glm::lessThan(tilePos, minTile)) || glm::any(glm::greaterThan(tilePos, maxTile)))
+            return false;
+        const glm::ivec2 firstChunk = tilePos * TILE_CHUNKS, lastChunk = firstChunk + TILE_CHUNKS - 1;
+        return glm::any(glm::lessThan(firstChunk, centerChunk - render)) || glm::any(glm::greaterThan(lastChunk, centerChunk + render));
+    };
+
+    for (auto it = tiles.begin(); it != tiles.end();)
+    {
+        if (isNeeded(it->first))
+        {
+            ++it;
+            continue;
+        }
+
+        it->second.token->store(true);
+        if (it->second.slot >= 0)
+        {
+            freeSlots.push_back(it->second.slot);
+            uploadedTiles--;
+        }
+        it = tiles.erase(it);
+    }
+
+    for (int32_t z = minTile.y; z <= maxTile.y; z++)
+    {
+        for (int32_t x = minTile.x; x <= maxTile.x; x++)
+        {
+            const glm::ivec2 tilePos{x, z};
+            if (!isNeeded(tilePos) || tiles.contains(tilePos))
+                continue;
+
+            const CancellationToken token = makeCancellationToken();
+            tiles[tilePos] = {token};
+            const float distance = glm::length(glm::vec2(tilePos * TILE_CHUNKS + TILE_CHUNKS / 2 - centerChunk));
+            threadPool.queueJob([results = results, worldGenData = worldGenData, token, tilePos]()
+            {
+                GeneratedTile tile{token, tilePos};
+                generateHorizonTile(*worldGenData, tilePos, tile.vertices);
+
+                std::lock_guard lock(results->mutex);
+                results->tiles.push_back(std::move(tile));
+            }, HORIZON_PRIORITY + distance, token);
+        }
+    }
+}
+
+uint32_t HorizonTerrain::update(const glm::ivec3& currChunkPos, const uint32_t renderDistance)
+{
+    if (config.horizonDistance == 0)
+        return 0;
+
+    // same strict cube as ChunkManager::updateFrontier
+    const int32_t render = int32_t(renderDistance) - 1;
+    if (!hasCenter || currChunkPos.x != center.x || currChunkPos.z != center.z || render != renderRadius)
+        updateTiles(currChunkPos, render);
+
+    std::vector<GeneratedTile> finished;
+    {
+        std::lock_guard lock(results->mutex);
+        const size_t count = glm::min<size_t>(results->tiles.size(), MAX_UPLOADS_PER_FRAME);
+        finished.assign(std::make_move_iterator(results->tiles.begin()), std::make_move_iterator(results->tiles.begin() + count));
+        results->tiles.erase(results->tiles.begin(), results->tiles.begin() + count);
+    }
+
+    if (finished.empty())
+        return 0;
+    if (vao.arrayID == 0)
+        createBuffers();
+
+    uint32_t uploads = 0;
+    GLCall(glBindBuffer(GL_ARRAY_BUFFER, vao.buffers[0]));
+    for (const auto& generated : finished)
+    {
+        // left the horizon while it was generated
+        const auto tile = tiles.find(generated.tilePos);
+        if (tile == tiles.end() || tile->second.token != generated.token)
+            continue;
+        if (freeSlots.empty())
+        {
+            LOG_WARN("Horizon buffer is full, tile {} {} is skipped", generated.tilePos.x, generated.tilePos.y);
+            continue;
+        }
+
+        tile->second.slot = freeSlots.back();
+        freeSlots.pop_back();
+        const auto offset = GLintptr(tile->second.slot) * TILE_VERTICES * sizeof(HorizonVertex);
+        GLCall(glBufferSubData(GL_ARRAY_BUFFER, offset, TILE_VERTICES * sizeof(HorizonVertex), generated.vertices.data()));
+        uploadedTiles++;
+        uploads++;
+    }
+
+    return uploads;
+}
+
+void HorizonTerrain::draw(Renderer& renderer)
+{
+    if (uploadedTiles == 0)
+        return;
+
+    drawCounts.clear();
+    drawIndices.clear();
+    drawBaseVertices.clear();
+    for (const auto& [_, tile] : tiles)
+    {
+        if (tile.slot < 0)
+            continue;
+
+        drawCounts.push_back(TILE_INDICES);
+        drawIndices.push_back(nullptr);
+        drawBaseVertices.push_back(tile.slot * TILE_VERTICES);
+    }
+
+    const glm::vec3 cutoutMin = chunkPosToWorldBlockPos(center - renderRadius);
+    const glm::vec3 cutoutMax = chunkPosToWorldBlockPos(center + renderRadius + 1);
+    renderer.drawHorizon(vao, drawCounts, drawIndices, drawBaseVertices, cutoutMin, cutoutMax);
+}
@@ -0,0 +1,356 @@
+#include "Lighting.h"
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include "cstmlib/Profiling.h"
+
+constexpr int32_t CHUNK_SIZE = Chunk::CHUNK_SIZE, CHUNK_SHIFT = 5;
+static_assert(1 << CHUNK_SHIFT == CHUNK_SIZE);
+constexpr uint32_t SKY = 0, BLOCK = 1;
+constexpr glm::ivec3 NEIGHBOUR_OFFSETS[] = {{0, 0, -1}, {0, 0, 1}, {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}};
+
+template<typename... Args>
+static std::shared_ptr<Chunk::LightVoxels> makeLightVoxels(Args&&... args)
+{
+    return std::allocate_shared<Chunk::LightVoxels>(TrackingAllocator<Chunk::LightVoxels, LIGHT_STORAGE>(), std::forward<Args>(args)...);
+}
+
+static uint32_t getIndex(const glm::ivec3& pos) { return pos.x + pos.y * CHUNK_SIZE + pos.z * CHUNK_SIZE * CHUNK_SIZE; }
+// world block positions to the chunk and the position in it, floored for negative positions as well
+static glm::ivec3 getChunkPos(const glm::ivec3& worldPos) { return worldPos >> CHUNK_SHIFT; }
+static uint32_t getLocalIndex(const glm::ivec3& worldPos) { return getIndex(worldPos & (CHUNK_SIZE - 1)); }
+
+static uint8_t getLevel(const uint8_t light, const uint32_t channel) { return (light >> (channel * BLOCK_LIGHT_SHIFT)) & SKY_LIGHT_MASK; }
+
+static uint8_t setLevel(const uint8_t light, const uint32_t channel, const uint8_t level)
+{
+    const uint32_t shift = channel * BLOCK_LIGHT_SHIFT;
+    return uint8_t((light & ~(SKY_LIGHT_MASK << shift)) | level << shift);
+}
+
+// Level a block gets from a neighbour at level, sky light keeps its full level going straight down through air
+static uint8_t getPropagatedLevel(const uint8_t level, const BLOCK_TYPE into, const bool isSkyDown)
+{
+    const uint8_t opacity = getLightOpacity(into);
+    if (isSkyDown && level == MAX_LIGHT && opacity == 0)
+        return MAX_LIGHT;
+    return level > opacity + 1 ? uint8_t(level - opacity - 1) : 0;
+}
+
+// Calls func(inside, outside) for the 32x32 positions on the face of a chunk and the positions
+// across the border in the neighbour, both in chunk coordinates
+template<typename F>
+static void forEachBorderPair(const uint32_t face, F&& func)
+{
+    const int32_t axis = face < 2 ? 2 : face < 4 ? 0 : 1;
+    const int32_t u = (axis + 1) % 3, v = (axis + 2) % 3;
+    glm::ivec3 inside, outside;
+    inside[axis] = face % 2 == 0 ? 0 : CHUNK_SIZE - 1;
+    outside[axis] = CHUNK_SIZE - 1 - inside[axis];
+    for (int32_t a = 0; a < CHUNK_SIZE; a++)
+    {
+        for (int32_t b = 0; b < CHUNK_SIZE; b++)
+        {
+            inside[u] = outside[u] = a;
+            inside[v] = outside[v] = b;
+            func(inside, outside);
+        }
+    }
+}
+
+void Chunk::LightStorage::set(const uint32_t index, const uint8_t light)
+{
+    if (!voxels)
+    {
+        if (light == uniform)
+            return;
+        voxels = makeLightVoxels();
+        voxels->fill(uniform);
+    }
+    // a job still reads the old light, copy on write like the blocks
+    else if (voxels.use_count() > 1)
+        voxels = makeLightVoxels(*voxels);
+
+    (*voxels)[index] = light;
+}
+
+void Chunk::LightStorage::assign(const LightVoxels& light)
+{
+    if (std::all_of(light.begin(), light.end(), [&](const uint8_t value) { return value == light[0]; }))
+    {
+        voxels.reset();
+        uniform = light[0];
+    }
+    else
+        voxels = makeLightVoxels(light);
+}
+
+void fillChunkLight(const Chunk::BlockStorage& blocks, const std::array<const Chunk::LightStorage*, 6>& neighbours, const bool openSky,
+                    Chunk::LightStorage& light)
+{
+    CAPTURE_SCOPE("Light Fill");
+    thread_local Chunk::LightVoxels levels;
+    thread_local std::vector<uint16_t> queue;
+    levels.fill(0);
+
+    const auto raise = [&](const uint32_t index, const uint32_t channel, const uint8_t level)
+    {
+        if (level <= getLevel(levels[index], channel))
+            return;
+        levels[index] = setLevel(levels[index], channel, level);
+        queue.push_back(uint16_t(index));
+    };
+
+    for (uint32_t channel = SKY; channel <= BLOCK; channel++)
+    {
+        queue.clear();
+        if (channel == BLOCK)
+        {
+            for (uint32_t index = 0; index < Chunk::BLOCKS_PER_CHUNK; index++)
+                if (const uint8_t emission = getLightEmission(blocks[index]))
+                    raise(index, channel, emission);
+        }
+
+        for (uint32_t face = 0; face < 6; face++)
+        {
+            const Chunk::LightStorage* neighbour = neighbours[face];
+            const bool isSky = channel == SKY && face == TOP && openSky && !neighbour;
+            if (!neighbour && !isSky)
+                continue;
+            // an evenly dark neighbour has nothing to give
+            if (neighbour && !neighbour->voxels && getLevel(neighbour->uniform, channel) <= 1)
+                continue;
+
+            forEachBorderPair(face, [&](const glm::ivec3& inside, const glm::ivec3& outside)
+            {
+                const uint8_t level = isSky ? MAX_LIGHT : getLevel(neighbour->get(getIndex(outside)), channel);
+                const uint32_t index = getIndex(inside);
+                raise(index, channel, getPropagatedLevel(level, blocks[index], channel == SKY && face == TOP));
+            });
+        }
+
+        for (size_t head = 0; head < queue.size(); head++)
+        {
+            const uint32_t index = queue[head];
+            const uint8_t level = getLevel(levels[index], channel);
+            if (level <= 1)
+                continue;
+
+            const glm::ivec3 pos{int32_t(index % CHUNK_SIZE), int32_t(index / CHUNK_SIZE % CHUNK_SIZE), int32_t(index / (CHUNK_SIZE * CHUNK_SIZE))};
+            for (uint32_t face = 0; face < 6; face++)
+            {
+                const glm::ivec3 neighbourPos = pos + NEIGHBOUR_OFFSETS[face];
+                if (!isChunkCoord(neighbourPos))
+                    continue;
+
+                const uint32_t neighbourIndex = getIndex(neighbourPos);
+                raise(neighbourIndex, channel, getPropagatedLevel(level, blocks[neighbourIndex], channel == SKY && face == BOTTOM));
+            }
+        }
+    }
+
+    light.assign(levels);
+}
+
+LightEngine::LightEngine(std::unordered_map<glm::ivec3, Chunk>& chunks)
+    : m_Chunks(chunks)
+{
+}
+
+Chunk* LightEngine::getLitChunk(const glm::ivec3& chunkPos)
+{
+    if (m_CachedChunk && m_CachedPos == chunkPos)
+        return m_CachedChunk;
+
+    const auto it = m_Chunks.find(chunkPos);
+    if (it == m_Chunks.end() || !it->second.isLit)
+        return nullptr;
+
+    m_CachedPos = chunkPos;
+    m_CachedChunk = &it->second;
+    return m_CachedChunk;
+}
+
+void LightEngine::setLevel(Chunk& chunk, const glm::ivec3& worldPos, const uint32_t index, const uint32_t channel, const uint8_t level)
+{
+    const uint8_t light = chunk.light.get(index);
+    if (level < getLevel(light, channel))
+        chunk.lightRevision++;
+    chunk.light.set(index, ::setLevel(light, channel, level));
+    m_ChangedVoxels++;
+
+    // the meshes of this chunk read it, and the neighbour's if it lies on the border
+    if (changedChunks.empty() || changedChunks.back() != chunk.chunkPosition)
+        changedChunks.push_back(chunk.chunkPosition);
+    const glm::ivec3 positionInChunk = worldPos & (CHUNK_SIZE - 1);
+    for (int32_t axis = 0; axis < 3; axis++)
+    {
+        glm::ivec3 offset{0};
+        if (positionInChunk[axis] == 0)
+            offset[axis] = -1;
+        else if (positionInChunk[axis] == CHUNK_SIZE - 1)
+            offset[axis] = 1;
+        if (offset[axis] != 0)
+            changedChunks.push_back(chunk.chunkPosition + offset);
+    }
+}
+
+void LightEngine::queueBlockChange(const glm::ivec3& worldPos)
+{
+    m_CachedChunk = nullptr;
+    Chunk* chunk = getLitChunk(getChunkPos(worldPos));
+    if (!chunk)
+        return;
+
+    const uint32_t index = getLocalIndex(worldPos);
+    const BLOCK_TYPE block = (*chunk->blocks)[index];
+    for (uint32_t channel = SKY; channel <= BLOCK; channel++)
+    {
+        const uint8_t level = getLevel(chunk->light.get(index), channel);
+        const uint8_t emitted = channel == BLOCK ? getLightEmission(block) : 0;
+        if (level != emitted)
+            setLevel(*chunk, worldPos, index, channel, emitted);
+        if (level > emitted)
+            m_Removals[channel].push_back({worldPos, level});
+        if (emitted > 0)
+            m_Additions[channel].push_back({worldPos});
+
+        // the block may let in light it stopped before
+        for (const auto& offset : NEIGHBOUR_OFFSETS)
+            m_Additions[channel].push_back({worldPos + offset});
+    }
+}
+
+void LightEngine::queueBorderExchange(const Chunk& chunk)
+{
+    m_CachedChunk = nullptr;
+    const glm::ivec3 origin = chunkPosToWorldBlockPos(chunk.chunkPosition);
+    for (uint32_t face = 0; face < 6; face++)
+    {
+        const Chunk* neighbour = getLitChunk(chunk.chunkPosition + NEIGHBOUR_OFFSETS[face]);
+        if (!neighbour)
+            continue;
+        // nothing can flow between two evenly lit chunks with the same light
+        if (!chunk.light.voxels && !neighbour->light.voxels && chunk.light.uniform == neighbour->light.uniform)
+            continue;
+
+        const glm::ivec3 neighbourOrigin = chunkPosToWorldBlockPos(neighbour->chunkPosition);
+        forEachBorderPair(face, [&](const glm::ivec3& inside, const glm::ivec3& outside)
+        {
+            const uint32_t insideIndex = getIndex(inside), outsideIndex = getIndex(outside);
+            const uint8_t insideLight = chunk.light.get(insideIndex), outsideLight = neighbour->light.get(outsideIndex);
+            if (insideLight == outsideLight)
+                return;
+
+            for (uint32_t channel = SKY; channel <= BLOCK; channel++)
+            {
+                const uint8_t insideLevel = getLevel(insideLight, channel), outsideLevel = getLevel(outsideLight, channel);
+                if (getPropagatedLevel(insideLevel, (*neighbour->blocks)[outsideIndex], channel == SKY && face == BOTTOM) > outsideLevel)
+                    m_Additions[channel].push_back({origin + inside});
+                if (getPropagatedLevel(outsideLevel, (*chunk.blocks)[insideIndex], channel == SKY && face == TOP) > insideLevel)
+                    m_Additions[channel].push_back({neighbourOrigin + outside});
+            }
+        });
+    }
+}
+
+void LightEngine::queueSkyCorrection(Chunk& chunk)
+{
+    m_CachedChunk = nullptr;
+    const Chunk* above = getLitChunk(chunk.chunkPosition + NEIGHBOUR_OFFSETS[TOP]);
+    if (!above || !chunk.isLit)
+        return;
+
+    // full sky light above is what the open sky gave anyway
+    const glm::ivec3 origin = chunkPosToWorldBlockPos(chunk.chunkPosition);
+    forEachBorderPair(TOP, [&](const glm::ivec3& inside, const glm::ivec3& outside)
+    {
+        if (getLevel(above->light.get(getIndex(outside)), SKY) == MAX_LIGHT)
+            return;
+
+        const uint32_t index = getIndex(inside);
+        const uint8_t level = getLevel(chunk.light.get(index), SKY);
+        if (level == 0)
+            return;
+        setLevel(chunk, origin + inside, index, SKY, 0);
+        m_Removals[SKY].push_back({origin + inside, level});
+    });
+}
+
+uint32_t LightEngine::propagate()
+{
+    CAPTURE_SCOPE("Light Propagation");
+    m_CachedChunk = nullptr;
+
+    for (uint32_t channel = SKY; channel <= BLOCK; channel++)
+    {
+        auto& removals = m_Removals[channel];
+        auto& additions = m_Additions[channel];
+
+        // light that came from where it was removed goes too, anything at least as bright came from
+        // elsewhere and spreads back in from there
+        for (size_t head = 0; head < removals.size(); head++)
+        {
+            const LightNode node = removals[head];
+            for (uint32_t face = 0; face < 6; face++)
+            {
+                const glm::ivec3 neighbourPos = node.pos + NEIGHBOUR_OFFSETS[face];
+                Chunk* neighbour = getLitChunk(getChunkPos(neighbourPos));
+                if (!neighbour)
+                    continue;
+
+                const uint32_t index = getLocalIndex(neighbourPos);
+                const uint8_t level = getLevel(neighbour->light.get(index), channel);
+                if (level == 0)
+                    continue;
+
+                const bool isSkyColumn = channel == SKY && face == BOTTOM && node.level == MAX_LIGHT && level == MAX_LIGHT;
+                if (level < node.level || isSkyColumn)
+                {
+                    const uint8_t emitted = channel == BLOCK ? getLightEmission((*neighbour->blocks)[index]) : 0;
+                    setLevel(*neighbour, neighbourPos, index, channel, emitted);
+                    removals.push_back({neighbourPos, level});
+                    if (emitted > 0)
+                        additions.push_back({neighbourPos});
+                }
+                else
+                    additions.push_back({neighbourPos});
+            }
+        }
+
+        for (size_t head = 0; head < additions.size(); head++)
+        {
+            const glm::ivec3 pos = additions[head].pos;
+            Chunk* chunk = getLitChunk(getChunkPos(pos));
+            if (!chunk)
+                continue;
+            const uint8_t level = getLevel(chunk->light.get(getLocalIndex(pos)), channel);
+            if (level <= 1)
+                continue;
+
+            for (uint32_t face = 0; face < 6; face++)
+            {
+                const glm::ivec3 neighbourPos = pos + NEIGHBOUR_OFFSETS[face];
+                Chunk* neighbour = getLitChunk(getChunkPos(neighbourPos));
+                if (!neighbour)
+                    continue;
+
+                const uint32_t index = getLocalIndex(neighbourPos);
+                const uint8_t propagated = getPropagatedLevel(level, (*neighbour->blocks)[index], channel == SKY && face == BOTTOM);
+                if (propagated <= getLevel(neighbour->light.get(index), channel))
+                    continue;
+
+                setLevel(*neighbour, neighbourPos, index, channel, propagated);
+                additions.push_back({neighbourPos});
+            }
+        }
+
+        removals.clear();
+        additions.clear();
+    }
+
+    const auto less = [](const glm::ivec3& a, const glm::ivec3& b) { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); };
+    std::sort(changedChunks.begin(), changedChunks.end(), less);
+    changedChunks.erase(std::unique(changedChunks.begin(), changedChunks.end()), changedChunks.end());
+    return std::exchange(m_ChangedVoxels, 0);
+}
@@ -0,0 +1,31 @@
+#include "MemoryStats.h"
+#include <sqlite3.h>
+
+struct MemoryCounter
+{
+    std::atomic<int64_t> bytes = 0, objects = 0;
+};
+
+static std::array<MemoryCounter, MEMORY_CATEGORY_COUNT> memoryCounters;
+
+void trackMemory(const MEMORY_CATEGORY category, const int64_t bytes, const int64_t objects)
+{
+    memoryCounters[category].bytes.fetch_add(bytes, std::memory_order_relaxed);
+    memoryCounters[category].objects.fetch_add(objects, std::memory_order_relaxed);
+}
+
+MemoryUsage getMemoryUsage(const MEMORY_CATEGORY category)
+{
+    // sqlite keeps its own running totals across all connections
+    if (category == SQLITE)
+    {
+        int current = 0, highwater = 0;
+        sqlite3_status(SQLITE_STATUS_MALLOC_COUNT, &current, &highwater, 0);
+        return {sqlite3_memory_used(), current};
+    }
+
+    return {
+        memoryCounters[category].bytes.load(std::memory_order_relaxed),
+        memoryCounters[category].objects.load(std::memory_order_relaxed)
+    };
+}
@@ -0,0 +1,44 @@
+#include "MeshBufferPool.h"
+#include "Block.h"
+
+void MeshBufferPool::release(VertexArray&& vao)
+{
+    // never uploaded, there is nothing on the GPU to recycle
+    if (vao.arrayID == 0)
+        return;
+
+    const int64_t bytes = int64_t(vao.vertexCount) * sizeof(blockdata);
+    released.push_back({std::move(vao), frame, bytes});
+    pooledBytes += bytes;
+    memory.set(pooledBytes, int64_t(released.size()));
+}
+
+VertexArray MeshBufferPool::acquire()
+{
+    if (released.empty() || released.front().releasedFrame + FRAMES_IN_FLIGHT > frame)
+        return {};
+
+    VertexArray vao = std::move(released.front().vao);
+    pooledBytes -= released.front().bytes;
+    released.pop_front();
+    memory.set(pooledBytes, int64_t(released.size()));
+    reused++;
+    return vao;
+}
+
+void MeshBufferPool::update()
+{
+    frame++;
+
+    uint32_t deletes = 0;
+    while (released.size() > MAX_POOLED && deletes < MAX_DELETES_PER_FRAME &&
+           released.front().releasedFrame + FRAMES_IN_FLIGHT <= frame)
+    {
+        pooledBytes -= released.front().bytes;
+        released.pop_front();
+        deletes++;
+    }
+
+    deleted += deletes;
+    memory.set(pooledBytes, int64_t(released.size()));
+}
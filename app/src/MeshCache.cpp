@@ -0,0 +1,337 @@
+#include "MeshCache.h"
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include "SQLiteCpp/Statement.h"
+#include "SQLiteCpp/Transaction.h"
+
+// Two independent lanes over 64 bit words, a false hit would need both to collide
+struct VolumeHasher
+{
+    uint64_t low = 0x9E3779B97F4A7C15ull, high = 0xC2B2AE3D27D4EB4Full;
+
+    void add(const uint64_t word)
+    {
+        low = (low ^ word) * 0xFF51AFD7ED558CCDull;
+        low ^= low >> 32;
+        high = std::rotl(high + word, 29) * 0x9FB21C651E98DF25ull;
+    }
+
+    static uint64_t finalize(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return h;
+    }
+};
+
+// Whole words of a storage
+template<typename T>
+static void addWords(VolumeHasher& hasher, const T& storage)
+{
+    static_assert(sizeof(T) % sizeof(uint64_t) == 0);
+    const auto* bytes = reinterpret_cast<const unsigned char*>(storage.data());
+    for (size_t offset = 0; offset < sizeof(T); offset += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, bytes + offset, sizeof(word));
+        hasher.add(word);
+    }
+}
+
+// the slab of a neighbour depth cells deep that borders the chunk on face: the far end of the neighbours in
+// BACK, LEFT and BOTTOM direction, the near end of the others
+template<typename F>
+static void forEachBorderCell(const uint32_t face, const int32_t depth, F&& func)
+{
+    constexpr int32_t SIZE = Chunk::CHUNK_SIZE;
+    const int32_t axis = face < 2 ? 2 : face < 4 ? 0 : 1;
+    glm::ivec3 min{0}, max{SIZE};
+    min[axis] = face % 2 == 0 ? SIZE - depth : 0;
+    max[axis] = face % 2 == 0 ? SIZE : depth;
+    for (int32_t z = min.z; z < max.z; z++)
+        for (int32_t y = min.y; y < max.y; y++)
+            for (int32_t x = min.x; x < max.x; x++)
+                func(uint32_t(x + y * SIZE + z * SIZE * SIZE));
+}
+
+MeshCacheKey hashPaddedVolume(const Chunk::BlockStorage& blocks, const std::array<const Chunk::BlockStorage*, 6>& neighbours,
+                              const std::array<const Chunk::BlockStorage*, 20>& diagonals,
+                              const Chunk::LightStorage& light, const std::array<const Chunk::LightStorage*, 6>& neighbourLight, const uint32_t lod)
+{
+    VolumeHasher hasher;
+    hasher.add(lod);
+    addWords(hasher, blocks);
+
+    // the mesher looks one cell past each side
+    const int32_t depth = 1 << lod;
+    for (uint32_t face = 0; face < 6; face++)
+    {
+        const Chunk::BlockStorage* neighbour = neighbours[face];
+        hasher.add(neighbour ? face : ~uint64_t(face));
+        if (neighbour)
+            forEachBorderCell(face, depth, [&](const uint32_t index) { hasher.add(uint64_t((*neighbour)[index])); });
+    }
+
+    if (lod != 0)
+        return {VolumeHasher::finalize(hasher.low), VolumeHasher::finalize(hasher.high)};
+
+    // an evenly lit chunk only adds its one value, tagged so it can't collide with a light byte per block
+    if (light.voxels)
+        addWords(hasher, *light.voxels);
+    else
+        hasher.add(~uint64_t(light.uniform));
+    for (uint32_t face = 0; face < 6; face++)
+    {
+        const Chunk::LightStorage* neighbour = neighbourLight[face];
+        hasher.add(neighbour ? face : ~uint64_t(face));
+        if (neighbour)
+            forEachBorderCell(face, 1, [&](const uint32_t index) { hasher.add(neighbour->get(index)); });
+    }
+
+    constexpr int32_t SIZE = Chunk::CHUNK_SIZE;
+    for (uint32_t i = 0; i < diagonals.size(); i++)
+    {
+        const Chunk::BlockStorage* diagonal = diagonals[i];
+        hasher.add(diagonal ? 6 + i : ~uint64_t(6 + i));
+        if (diagonal)
+            forEachTouchingBlock(DIAGONAL_OFFSETS[i], [&](const glm::ivec3& pos)
+            {
+                hasher.add(uint64_t((*diagonal)[pos.x + pos.y * SIZE + pos.z * SIZE * SIZE]));
+            });
+    }
+
+    return {VolumeHasher::finalize(hasher.low), VolumeHasher::finalize(hasher.high)};
+}
+
+static size_t getEntryBytes(const MeshCache::Entry& entry)
+{
+    return sizeof(MeshCache::Entry) + (entry.opaque.size() + entry.translucent.size()) * sizeof(blockdata);
+}
+
+static int64_t getUnixSeconds()
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+MeshCache::MeshCache(const size_t capacityBytes, const std::string& filePath, const size_t fileCapacityBytes)
+    : capacityBytes(capacityBytes)
+{
+    if (filePath.empty())
+        return;
+
+    const std::string MESH_TABLE =
+        "MeshCache("
+        "keyLow INTEGER,"
+        "keyHigh INTEGER,"
+        "opaque BLOB,"
+        "translucent BLOB,"
+        "faceCounts BLOB,"
+        "meshMs REAL,"
+        "bytes INTEGER,"
+        "used INTEGER,"
+        "PRIMARY KEY (keyLow, keyHigh))";
+
+    try
+    {
+        db = std::make_unique<SQLite::Database>(filePath, SQLite::OPEN_READWRITE | SQLite::OPEN_CREATE);
+        db->exec("PRAGMA journal_mode=WAL");
+        // the faces are stored as they are packed in memory, another mesher version would decode them wrong
+        if (db->execAndGet("PRAGMA user_version").getInt() != FILE_VERSION)
+        {
+            db->exec("DROP TABLE IF EXISTS MeshCache");
+            db->exec("PRAGMA user_version = " + std::to_string(FILE_VERSION));
+        }
+        db->exec("CREATE TABLE IF NOT EXISTS " + MESH_TABLE);
+
+        // least recently used entries past the file capacity
+        SQLite::Statement trim(*db, "DELETE FROM MeshCache WHERE rowid IN (SELECT rowid FROM "
+                                    "(SELECT rowid, SUM(bytes) OVER (ORDER BY used DESC, rowid) AS total FROM MeshCache) WHERE total > ?)");
+        trim.bind(1, int64_t(fileCapacityBytes));
+        trim.exec();
+    }
+    catch (const SQLite::Exception& e)
+    {
+        LOG_WARN("Mesh cache file {} can't be used, meshes are only cached in memory: {}", filePath, e.what());
+        db.reset();
+    }
+}
+
+MeshCache::~MeshCache()
+{
+    if (!db)
+        return;
+
+    // keeps what this session meshed for the next one, entries read from the file only get their use time updated
+    std::vector<MeshCacheKey> used;
+    for (auto& entry : entries)
+    {
+        if (entry.isStored)
+            used.push_back(entry.key);
+        else
+            spilled.push_back(std::move(entry));
+    }
+    writeEntries(spilled);
+
+    try
+    {
+        SQLite::Transaction transaction(*db);
+        SQLite::Statement touch(*db, "UPDATE MeshCache SET used = ? WHERE keyLow = ? AND keyHigh = ?");
+        for (const MeshCacheKey& key : used)
+        {
+            touch.bind(1, getUnixSeconds());
+            touch.bind(2, int64_t(key.low));
+            touch.bind(3, int64_t(key.high));
+            touch.exec();
+            touch.reset();
+        }
+        transaction.commit();
+    }
+    catch (const SQLite::Exception& e)
+    {
+        LOG_ERROR("Updating the mesh cache file failed: {}", e.what());
+    }
+}
+
+std::optional<float> MeshCache::find(const MeshCacheKey& key, GeneratedMesh& mesh)
+{
+    const auto copyOut = [&](const Entry& entry)
+    {
+        mesh.meshDataOpaque.assign(entry.opaque.begin(), entry.opaque.end());
+        mesh.meshDataTranslucent.assign(entry.translucent.begin(), entry.translucent.end());
+        mesh.faceCountsOpaque = entry.faceCounts;
+        return entry.meshMs;
+    };
+
+    {
+        std::lock_guard lock(mutex);
+        if (const auto it = index.find(key); it != index.end())
+        {
+            entries.splice(entries.begin(), entries, it->second);
+            return copyOut(*it->second);
+        }
+    }
+
+    if (!db)
+        return std::nullopt;
+    std::optional<Entry> entry = readEntry(key);
+    if (!entry)
+        return std::nullopt;
+
+    fileHits++;
+    const float meshMs = copyOut(*entry);
+    std::lock_guard lock(mutex);
+    if (!index.contains(key))
+        store(std::move(*entry));
+    return meshMs;
+}
+
+void MeshCache::insert(const MeshCacheKey& key, const GeneratedMesh& mesh, const float meshMs)
+{
+    Entry entry{key, Faces(mesh.meshDataOpaque.begin(), mesh.meshDataOpaque.end()),
+                Faces(mesh.meshDataTranslucent.begin(), mesh.meshDataTranslucent.end()), mesh.faceCountsOpaque, meshMs};
+
+    std::vector<Entry> written;
+    {
+        std::lock_guard lock(mutex);
+        // two jobs meshed the same content
+        if (index.contains(key))
+            return;
+
+        store(std::move(entry));
+        if (spilled.size() >= SPILL_BATCH)
+            written.swap(spilled);
+    }
+
+    // outside the lock, the other jobs keep using the memory cache meanwhile
+    if (!written.empty())
+        writeEntries(written);
+}
+
+void MeshCache::store(Entry&& entry)
+{
+    bytes += getEntryBytes(entry);
+    entries.push_front(std::move(entry));
+    index[entries.front().key] = entries.begin();
+
+    while (bytes > capacityBytes && entries.size() > 1)
+    {
+        Entry& evicted = entries.back();
+        bytes -= getEntryBytes(evicted);
+        index.erase(evicted.key);
+        if (db && !evicted.isStored)
+            spilled.push_back(std::move(evicted));
+        entries.pop_back();
+    }
+}
+
+std::optional<MeshCache::Entry> MeshCache::readEntry(const MeshCacheKey& key)
+{
+    const auto readFaces = [](const SQLite::Column& column, Faces& faces)
+    {
+        faces.resize(size_t(column.getBytes()) / sizeof(blockdata));
+        if (!faces.empty())
+            std::memcpy(faces.data(), column.getBlob(), faces.size() * sizeof(blockdata));
+    };
+
+    std::lock_guard lock(fileMutex);
+    try
+    {
+        SQLite::Statement query(*db, "SELECT opaque, translucent, faceCounts, meshMs FROM MeshCache WHERE keyLow = ? AND keyHigh = ?");
+        query.bind(1, int64_t(key.low));
+        query.bind(2, int64_t(key.high));
+        if (!query.executeStep())
+            return std::nullopt;
+
+        Entry entry{key};
+        readFaces(query.getColumn(0), entry.opaque);
+        readFaces(query.getColumn(1), entry.translucent);
+        const SQLite::Column faceCounts = query.getColumn(2);
+        if (size_t(faceCounts.getBytes()) != sizeof(entry.faceCounts))
+            return std::nullopt;
+        std::memcpy(entry.faceCounts.data(), faceCounts.getBlob(), sizeof(entry.faceCounts));
+        entry.meshMs = float(query.getColumn(3).getDouble());
+        entry.isStored = true;
+        return entry;
+    }
+    catch (const SQLite::Exception& e)
+    {
+        LOG_ERROR("Reading the mesh cache file failed: {}", e.what());
+        return std::nullopt;
+    }
+}
+
+void MeshCache::writeEntries(const std::vector<Entry>& written)
+{
+    if (written.empty())
+        return;
+
+    std::lock_guard lock(fileMutex);
+    try
+    {
+        // one transaction per batch, a commit per entry would sync the file every time
+        SQLite::Transaction transaction(*db);
+        SQLite::Statement insert(*db, "INSERT OR REPLACE INTO MeshCache VALUES(?, ?, ?, ?, ?, ?, ?, ?)");
+        const int64_t now = getUnixSeconds();
+        for (const Entry& entry : written)
+        {
+            insert.bind(1, int64_t(entry.key.low));
+            insert.bind(2, int64_t(entry.key.high));
+            insert.bind(3, entry.opaque.data(), int(entry.opaque.size() * sizeof(blockdata)));
+            insert.bind(4, entry.translucent.data(), int(entry.translucent.size() * sizeof(blockdata)));
+            insert.bind(5, entry.faceCounts.data(), int(sizeof(entry.faceCounts)));
+            insert.bind(6, double(entry.meshMs));
+            insert.bind(7, int64_t(getEntryBytes(entry)));
+            insert.bind(8, now);
+            insert.exec();
+            insert.reset();
+        }
+        transaction.commit();
+        spilledEntries += written.size();
+    }
+    catch (const SQLite::Exception& e)
+    {
+        LOG_ERROR("Writing the mesh cache file failed: {}", e.what());
+    }
+}
@@ -0,0 +1,89 @@
+#include "MeshUploader.h"
+#include "OpenGLHelper.h"
+
+MeshUploader::MeshUploader(SharedContext&& context)
+    :   context(std::move(context)),
+        thread([this](const std::stop_token& st) { threadLoop(st); })
+{
+}
+
+MeshUploader::~MeshUploader()
+{
+    thread.request_stop();
+    thread.join();
+
+    for (const auto& mesh : uploaded)
+        deleteUploadedMesh(mesh);
+    context.destroy();
+}
+
+void MeshUploader::queueUpload(MeshUpload&& upload)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        uploads.push(std::move(upload));
+    }
+    queueCondition.notify_one();
+}
+
+std::vector<UploadedMesh> MeshUploader::collectUploads()
+{
+    std::vector<UploadedMesh> finished;
+    std::lock_guard<std::mutex> lock(queueMutex);
+    std::erase_if(uploaded, [&](UploadedMesh& mesh)
+    {
+        if (glClientWaitSync(mesh.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            return false;
+
+        glDeleteSync(mesh.fence);
+        finished.push_back(std::move(mesh));
+        finished.back().fence = nullptr;
+        return true;
+    });
+
+    return finished;
+}
+
+void deleteUploadedMesh(const UploadedMesh& mesh)
+{
+    const GLuint buffers[] = {mesh.bufferOpaque, mesh.bufferTranslucent};
+    GLCall(glDeleteBuffers(2, buffers))
+    if (mesh.fence)
+        glDeleteSync(mesh.fence);
+}
+
+void MeshUploader::threadLoop(const std::stop_token& st)
+{
+    context.makeCurrent(true);
+
+    while (true)
+    {
+        MeshUpload upload;
+
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, st, [&] { return !uploads.empty(); });
+            if (st.stop_requested())
+                break;
+
+            upload = std::move(uploads.front());
+            uploads.pop();
+        }
+
+        UploadedMesh mesh{upload.position, upload.meshRevision};
+        mesh.bufferOpaque = createBuffer(upload.meshDataOpaque.data(), GLsizei(upload.meshDataOpaque.size() * sizeof(blockdata)));
+        mesh.bufferTranslucent = createBuffer(upload.meshDataTranslucent.data(), GLsizei(upload.meshDataTranslucent.size() * sizeof(blockdata)));
+        mesh.vertexCountOpaque = upload.meshDataOpaque.size();
+        mesh.vertexCountTranslucent = upload.meshDataTranslucent.size();
+        mesh.faceCountsOpaque = upload.faceCountsOpaque;
+        mesh.meshDataTranslucent = std::move(upload.meshDataTranslucent);
+        mesh.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // the fence has to reach the GPU before the render thread can see it signal
+        glFlush();
+
+        std::lock_guard<std::mutex> lock(queueMutex);
+        uploaded.push_back(std::move(mesh));
+    }
+
+    context.makeCurrent(false);
+}
@@ -0,0 +1,109 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static std::array<MetricData, MAX_METRICS> metrics;
+static std::atomic<size_t> metricCount = 0;
+static std::mutex registryMutex;
+// rings are never freed, a thread that exits leaves its last samples behind for the next merge
+static std::vector<std::unique_ptr<ThreadSampleRing>> threadRings;
+
+static ThreadSampleRing& getThreadRing()
+{
+    thread_local ThreadSampleRing* ring = nullptr;
+    if (!ring)
+    {
+        std::lock_guard lock(registryMutex);
+        ring = threadRings.emplace_back(std::make_unique<ThreadSampleRing>()).get();
+    }
+
+    return *ring;
+}
+
+MetricID registerMetric(const char* name)
+{
+    std::lock_guard lock(registryMutex);
+
+    const size_t count = metricCount.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; i++)
+    {
+        if (std::strcmp(metrics[i].name, name) == 0)
+            return MetricID(i);
+    }
+
+    if (count == MAX_METRICS)
+    {
+        // too many metrics, share the last slot rather than writing out of bounds
+        return MetricID(MAX_METRICS - 1);
+    }
+
+    metrics[count].name = name;
+    metricCount.store(count + 1, std::memory_order_release);
+    return MetricID(count);
+}
+
+void pushMetricSample(const MetricID id, const float ms)
+{
+    ThreadSampleRing& ring = getThreadRing();
+    const uint32_t head = ring.head.load(std::memory_order_relaxed);
+    const uint32_t tail = ring.tail.load(std::memory_order_acquire);
+
+    // the main thread has not merged for a while, drop the sample instead of blocking
+    if (head - tail == THREAD_SAMPLE_CAPACITY)
+        return;
+
+    ring.samples[head % THREAD_SAMPLE_CAPACITY] = {id, ms};
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void mergeMetricSamples()
+{
+    std::lock_guard lock(registryMutex);
+
+    for (const auto& ring : threadRings)
+    {
+        const uint32_t head = ring->head.load(std::memory_order_acquire);
+        uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+
+        for (; tail != head; tail++)
+        {
+            const MetricSample& sample = ring->samples[tail % THREAD_SAMPLE_CAPACITY];
+            metrics[sample.id].values.push(sample.ms);
+        }
+
+        ring->tail.store(tail, std::memory_order_release);
+    }
+}
+
+size_t getMetricCount()
+{
+    return metricCount.load(std::memory_order_acquire);
+}
+
+MetricData& getMetric(const MetricID id)
+{
+    return metrics[id];
+}
+
+MetricSummary summarizeMetric(MetricData& data)
+{
+    MetricSummary summary;
+    if (data.values.empty())
+        return summary;
+
+    std::array<double, SAMPLE_COUNT> sorted;
+    size_t count = 0;
+    for (const auto& val : data.values)
+        sorted[count++] = val;
+    std::sort(sorted.begin(), sorted.begin() + count);
+
+    const auto percentile = [&](const double p) { return sorted[size_t(p * double(count - 1) + 0.5)]; };
+    summary.p50 = percentile(0.50);
+    summary.p95 = percentile(0.95);
+    summary.p99 = percentile(0.99);
+    summary.max = sorted[count - 1];
+    return summary;
+}
@@ -0,0 +1,65 @@
+#include "RenderDistanceController.h"
+#include <algorithm>
+#include "GameWorld.h"
+
+// hysteresis: shrink quickly when frames are missed, grow slowly and only when the prediction fits
+constexpr double SHRINK_THRESHOLD = 1.15, GROW_THRESHOLD = 0.75;
+constexpr double SHRINK_HOLD_SECONDS = 0.5, GROW_HOLD_SECONDS = 3.0;
+constexpr double SMOOTHING = 0.05;
+
+// chunks in the render cube at a distance, it never reaches past the height of the world
+static double getRenderCubeChunks(const double distance)
+{
+    const double side = 2.0 * distance + 1.0;
+    return side * side * std::min(side, double(WorldGenerationData::WORLD_HEIGHT));
+}
+
+RenderDistanceController::RenderDistanceController(const GameConfig& config)
+    :   renderDistance(config.renderDistance),
+        minRenderDistance(std::min(config.minRenderDistance, config.renderDistance)),
+        maxRenderDistance(config.renderDistance),
+        targetFrameMs(config.frameBudgetMs)
+{
+}
+
+uint32_t RenderDistanceController::update(const double frameMs, const double workMs, const uint32_t drawnChunks)
+{
+    // single hitches (loading, window moves) say nothing about the steady state
+    constexpr double MAX_FRAME_MS = 250.0;
+    if (frameMs > MAX_FRAME_MS)
+        return renderDistance;
+
+    smoothedFrameMs = smoothedFrameMs == 0.0 ? frameMs : smoothedFrameMs + SMOOTHING * (frameMs - smoothedFrameMs);
+    smoothedWorkMs = smoothedWorkMs == 0.0 ? workMs : smoothedWorkMs + SMOOTHING * (workMs - smoothedWorkMs);
+    const double dt = frameMs / 1000.0;
+
+    if (smoothedFrameMs > targetFrameMs * SHRINK_THRESHOLD)
+        overBudgetTime += dt;
+    else
+        overBudgetTime = 0.0;
+
+    // the work grows with the chunks drawn, predict it at the next distance from the chunks drawn now before
+    // growing. A frame that drew nothing counts as one chunk so it doesn't look cheap.
+    const double d = double(std::max(renderDistance, 1u));
+    const double drawScale = std::max(getRenderCubeChunks(d + 1.0) / double(std::max(drawnChunks, 1u)), 1.0);
+    if (smoothedFrameMs <= targetFrameMs * SHRINK_THRESHOLD && smoothedWorkMs * drawScale < targetFrameMs * GROW_THRESHOLD)
+        underBudgetTime += dt;
+    else
+        underBudgetTime = 0.0;
+
+    if (overBudgetTime >= SHRINK_HOLD_SECONDS && renderDistance > minRenderDistance)
+    {
+        renderDistance--;
+        overBudgetTime = 0.0;
+        // let the average settle on the new distance before the next decision
+        smoothedFrameMs = smoothedWorkMs = 0.0;
+    }
+    else if (underBudgetTime >= GROW_HOLD_SECONDS && renderDistance < maxRenderDistance)
+    {
+        renderDistance++;
+        underBudgetTime = 0.0;
+        smoothedFrameMs = smoothedWorkMs = 0.0;
+    }
+
+    return renderDistance;
+}
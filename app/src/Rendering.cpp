@@ -9,12 +9,47 @@
 
 VertexArray createHighlightVAO();
 
+// uniform block binding points, the same in every program
+constexpr GLuint FRAME_BINDING = 0;
+constexpr GLuint CHUNK_BINDING = 1;
+// s_chunksPerBatch in BlockVert.glsl, 16KB is the largest block GL 3.3 guarantees
+constexpr uint32_t CHUNKS_PER_BATCH = 1024;
+constexpr GLsizeiptr CHUNK_BATCH_BYTES = CHUNKS_PER_BATCH * sizeof(glm::vec4);
+
+// std140 layout of the FrameData block
+struct FrameUniforms
+{
+    glm::mat4 viewProjection;
+    glm::vec4 exposure;
+    glm::vec4 lightDirection;
+    glm::vec4 lightColor;
+};
+
 Renderer::Renderer()
     :   m_BasicShader("../resources/shaders/BasicVert.glsl", "../resources/shaders/BasicFrag.glsl"),
         m_BlockShader("../resources/shaders/BlockVert.glsl", "../resources/shaders/BlockFrag.glsl"),
+        m_HorizonShader("../resources/shaders/HorizonVert.glsl", "../resources/shaders/HorizonFrag.glsl"),
         m_HighlightVao(createHighlightVAO()),
-        m_TextureAtlas("../resources/textures/TextureAtlas.png")
+        m_TextureAtlas("../resources/textures/TextureAtlas.png"),
+        m_FrameData(sizeof(FrameUniforms)),
+        m_ChunkData(CHUNK_BATCH_BYTES),
+        m_HighlightData(CHUNK_BATCH_BYTES),
+        m_BasicVPUniform(m_BasicShader.getUniform("u_VP")),
+        m_BasicPositionUniform(m_BasicShader.getUniform("u_GlobalPosition")),
+        m_ChunkIndexUniform(m_BlockShader.getUniform("u_chunkIndex")),
+        m_CutoutMinUniform(m_HorizonShader.getUniform("u_cutoutMin")),
+        m_CutoutMaxUniform(m_HorizonShader.getUniform("u_cutoutMax"))
 {
+    m_BlockShader.bindUniformBlock("FrameData", FRAME_BINDING);
+    m_BlockShader.bindUniformBlock("ChunkData", CHUNK_BINDING);
+    m_HorizonShader.bindUniformBlock("FrameData", FRAME_BINDING);
+    m_FrameData.bindBase(FRAME_BINDING);
+
+    // sampler units are program state, they only need to be set once
+    m_BlockShader.bind();
+    m_BlockShader.setUniform1i("u_textureSlot", 0);
+    m_BlockShader.unbind();
+
     GLCall(glEnable(GL_CULL_FACE));
     GLCall(glCullFace(GL_FRONT));
     GLCall(glEnable(GL_DEPTH_TEST));
@@ -29,31 +64,72 @@ void Renderer::drawEntity(const VertexArray& vao, const glm::vec3& pos, const gl
     vao.bind();
     m_BasicShader.bind();
 
-    m_BasicShader.setUniformMat4("u_VP", viewProjection);
-    m_BasicShader.setUniform3f("u_GlobalPosition", pos);
+    m_BasicShader.setUniformMat4(m_BasicVPUniform, viewProjection);
+    m_BasicShader.setUniform3f(m_BasicPositionUniform, pos);
     GLCall(glDrawArrays(GL_LINES, 0, vao.vertexCount));
 }
 
-void Renderer::prepareChunkRendering(const glm::mat4& viewProjection, const float exposure)
+void Renderer::beginFrame(const glm::mat4& viewProjection, const float exposure)
 {
+    const FrameUniforms frame{viewProjection, glm::vec4(exposure), LIGHT_DIRECTION, LIGHT_COLOR};
+    m_FrameData.update(&frame, sizeof(frame));
+}
+
+void Renderer::prepareChunkRendering(const std::span<const glm::vec4> chunks)
+{
+    // every batch is bound as a whole, so the last one needs its full size too
+    const auto batches = GLsizeiptr((chunks.size() + CHUNKS_PER_BATCH - 1) / CHUNKS_PER_BATCH);
+    m_ChunkData.reserve(glm::max<GLsizeiptr>(batches, 1) * CHUNK_BATCH_BYTES);
+    m_ChunkData.upload(chunks.data(), GLsizeiptr(chunks.size_bytes()));
+    m_BoundChunkBatch = -1;
+
     m_TextureAtlas.bind(0);
     m_BlockShader.bind();
-    m_BlockShader.setUniformMat4("u_VP", viewProjection);
-    m_BlockShader.setUniform1i("u_textureSlot", 0);
-    m_BlockShader.setUniform3f("u_exposure", glm::vec3{exposure});
 }
 
-void Renderer::drawChunk(const VertexArray& vao, const glm::ivec3& globalOffset)
+void Renderer::bindChunk(const uint32_t chunkIndex)
+{
+    const auto batch = int32_t(chunkIndex / CHUNKS_PER_BATCH);
+    if (batch != m_BoundChunkBatch)
+    {
+        m_ChunkData.bindRange(CHUNK_BINDING, batch * CHUNK_BATCH_BYTES, CHUNK_BATCH_BYTES);
+        m_BoundChunkBatch = batch;
+    }
+    m_BlockShader.setUniform1i(m_ChunkIndexUniform, int(chunkIndex % CHUNKS_PER_BATCH));
+}
+
+void Renderer::drawChunk(const VertexArray& vao, const uint32_t chunkIndex)
 {
     if (vao.vertexCount == 0)
         return;
 
-    m_BlockShader.setUniform3f("u_chunkOffset", glm::vec3(globalOffset));
+    bindChunk(chunkIndex);
     vao.bind();
     GLCall(glDrawArraysInstanced(GL_TRIANGLES, 0, 6, vao.vertexCount));
 }
 
-void Renderer::drawHighlightBlock(const glm::vec3& pos, const glm::mat4& viewProjection, const float exposure)
+void Renderer::drawChunk(const VertexArray& vao, const uint32_t chunkIndex, const std::span<const InstanceRange> ranges)
+{
+    if (vao.vertexCount == 0 || ranges.empty())
+        return;
+
+    bindChunk(chunkIndex);
+    vao.bind();
+
+    // GL 3.3 has no base instance, the instanced attribute is pointed at each range instead
+    GLCall(glBindBuffer(GL_ARRAY_BUFFER, vao.buffers[0]));
+    for (const auto& [first, count] : ranges)
+    {
+        GLCall(glVertexAttribIPointer(0, BLOCKDATA_COMPONENTS, GL_UNSIGNED_INT, sizeof(blockdata), reinterpret_cast<void*>(uintptr_t(first) * sizeof(blockdata))));
+        GLCall(glDrawArraysInstanced(GL_TRIANGLES, 0, 6, count));
+    }
+
+    // recycled vertex arrays and full draws expect the attribute at the start of the buffer
+    if (ranges.back().first != 0)
+        GLCall(glVertexAttribIPointer(0, BLOCKDATA_COMPONENTS, GL_UNSIGNED_INT, sizeof(blockdata), nullptr));
+}
+
+void Renderer::drawHighlightBlock(const glm::vec3& pos)
 {
     GLCall(glEnable(GL_DEPTH_TEST));
     GLCall(glDepthFunc(GL_LEQUAL));
@@ -62,15 +138,34 @@ void Renderer::drawHighlightBlock(const glm::vec3& pos, const glm::mat4& viewPro
     m_TextureAtlas.bind(0);
     m_BlockShader.bind();
 
-    m_BlockShader.setUniformMat4("u_VP", viewProjection);
-    m_BlockShader.setUniform1i("u_textureSlot", 0);
-    m_BlockShader.setUniform3f("u_chunkOffset", pos);
-    m_BlockShader.setUniform3f("u_exposure", glm::vec3(exposure));
+    // its own buffer, the chunk batches stay untouched for the rest of the frame
+    const glm::vec4 highlight{pos, 1.0f};
+    m_HighlightData.update(&highlight, sizeof(highlight));
+    m_HighlightData.bindBase(CHUNK_BINDING);
+    m_BoundChunkBatch = -1;
+    m_BlockShader.setUniform1i(m_ChunkIndexUniform, 0);
 
     GLCall(glDrawArraysInstanced(GL_TRIANGLES, 0, 6, m_HighlightVao.vertexCount));
     GLCall(glDepthFunc(GL_LESS));
 }
 
+void Renderer::drawHorizon(const VertexArray& vao, const std::vector<GLsizei>& counts, const std::vector<const void*>& indices, const std::vector<GLint>& baseVertices,
+                           const glm::vec3& cutoutMin, const glm::vec3& cutoutMax)
+{
+    if (counts.empty())
+        return;
+
+    m_HorizonShader.bind();
+    m_HorizonShader.setUniform3f(m_CutoutMinUniform, cutoutMin);
+    m_HorizonShader.setUniform3f(m_CutoutMaxUniform, cutoutMax);
+
+    // the heightfield is only ever seen from above, no need to keep its winding consistent with the blocks
+    GLCall(glDisable(GL_CULL_FACE));
+    vao.bind();
+    GLCall(glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_SHORT, indices.data(), GLsizei(counts.size()), baseVertices.data()));
+    GLCall(glEnable(GL_CULL_FACE));
+}
+
 void Renderer::clearFrame(const float skyExposure) const
 {
     glClearColor(0.5f * skyExposure, 0.8f * skyExposure, 0.9f * skyExposure, 1.0f);
@@ -83,11 +178,11 @@ VertexArray createHighlightVAO()
     const glm::uvec2 atlasOffset = getAtlasOffset(BLOCK_TYPE::HIGHLIGHTED, (FACE) 0);
 
     for (uint32_t i = 0; i < buffer.size(); i++)
-        buffer[i] = packBlockData(glm::uvec3(0), atlasOffset, (FACE) i);
+        buffer[i] = packBlockData(glm::uvec3(0), atlasOffset, (FACE) i, OPEN_SKY_LIGHT, NO_OCCLUSION);
 
     VertexArray highlightVao;
     VertexBufferLayout highlightLayout;
-    highlightLayout.pushUInt(1, false, 1);
+    highlightLayout.pushUInt(BLOCKDATA_COMPONENTS, false, 1);
     highlightVao.addBuffer(createBuffer(buffer.data(), sizeof(blockdata) * buffer.size()), highlightLayout);
     highlightVao.vertexCount = buffer.size();
 
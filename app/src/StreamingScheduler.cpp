@@ -0,0 +1,59 @@
+#include "StreamingScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+// share of the streaming budget each stage may spend
+constexpr std::array<double, STREAM_STAGE_COUNT> STAGE_SHARES = {0.1, 0.4, 0.35, 0.15};
+// streaming never stops completely, even when the frame is already over budget
+constexpr double MIN_STREAMING_BUDGET_MS = 1.0;
+
+StreamingScheduler::StreamingScheduler(const GameConfig& config)
+    :   maxQuotas{config.maxUnloadsPerFrame, config.maxLoadsPerFrame, config.maxBakesPerFrame, config.maxBakesPerFrame},
+        frameBudgetMs(config.frameBudgetMs)
+{
+    quotas = maxQuotas;
+}
+
+void StreamingScheduler::beginFrame()
+{
+    m_UpdateStart = std::chrono::steady_clock::now();
+    streamingMs = 0.0;
+}
+
+void StreamingScheduler::endUpdate()
+{
+    m_UpdateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_UpdateStart).count();
+}
+
+void StreamingScheduler::beginRender()
+{
+    m_RenderStart = std::chrono::steady_clock::now();
+}
+
+void StreamingScheduler::endRender()
+{
+    m_RenderMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_RenderStart).count();
+    frameWorkMs = m_UpdateMs + m_RenderMs;
+    updateQuotas();
+}
+
+void StreamingScheduler::updateQuotas()
+{
+    constexpr double SMOOTHING = 0.1;
+    const double otherMs = std::max(m_UpdateMs - streamingMs, 0.0) + m_RenderMs;
+    otherWorkMs = otherWorkMs == 0.0 ? otherMs : otherWorkMs + SMOOTHING * (otherMs - otherWorkMs);
+    streamingBudgetMs = std::max(frameBudgetMs - otherWorkMs, MIN_STREAMING_BUDGET_MS);
+
+    for (uint32_t stage = 0; stage < STREAM_STAGE_COUNT; stage++)
+    {
+        // nothing measured yet, run at the configured maximum until we know better
+        if (costPerItemMs[stage] == 0.0)
+        {
+            quotas[stage] = maxQuotas[stage];
+            continue;
+        }
+
+        const double items = std::floor(STAGE_SHARES[stage] * streamingBudgetMs / costPerItemMs[stage]);
+        quotas[stage] = std::clamp<uint32_t>(uint32_t(std::min(items, double(maxQuotas[stage]))), 1, std::max(maxQuotas[stage], 1u));
+    }
+}
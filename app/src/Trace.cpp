@@ -0,0 +1,113 @@
+#include "Trace.h"
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cstmlib/Log.h"
+
+struct ThreadTraceBuffer
+{
+    std::mutex mutex;
+    std::vector<TraceEvent> events;
+    std::thread::id threadID;
+};
+
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<ThreadTraceBuffer>> threadBuffers;
+// in steady clock ticks, workers read it without the registry lock and a restart may rewrite it meanwhile
+static std::atomic<std::chrono::steady_clock::rep> traceStartTicks = 0;
+
+static ThreadTraceBuffer& getThreadBuffer()
+{
+    thread_local ThreadTraceBuffer* buffer = nullptr;
+    if (!buffer)
+    {
+        std::lock_guard lock(registryMutex);
+        buffer = threadBuffers.emplace_back(std::make_unique<ThreadTraceBuffer>()).get();
+        buffer->threadID = std::this_thread::get_id();
+    }
+
+    return *buffer;
+}
+
+void startTraceRecording()
+{
+    {
+        std::lock_guard lock(registryMutex);
+        for (const auto& buffer : threadBuffers)
+        {
+            std::lock_guard bufferLock(buffer->mutex);
+            buffer->events.clear();
+        }
+        traceStartTicks.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+    }
+
+    // pairs with the acquire in isTraceRecording, threads that see the recording also see its start
+    traceRecording.store(true, std::memory_order_release);
+    LOG_INFO("Trace recording started");
+}
+
+void recordTraceEvent(const char* name, const char* category, const std::chrono::steady_clock::time_point start,
+                      const std::chrono::steady_clock::time_point end, const glm::ivec3* chunkPosition)
+{
+    using namespace std::chrono;
+    const steady_clock::time_point traceStart{steady_clock::duration(traceStartTicks.load(std::memory_order_relaxed))};
+    TraceEvent event{name, category, duration_cast<microseconds>(start - traceStart).count(),
+                     duration_cast<microseconds>(end - start).count(), glm::ivec3(0), chunkPosition != nullptr};
+    if (chunkPosition)
+        event.chunkPosition = *chunkPosition;
+
+    ThreadTraceBuffer& buffer = getThreadBuffer();
+    std::lock_guard lock(buffer.mutex);
+    buffer.events.push_back(event);
+}
+
+bool stopTraceRecording(const std::string& path)
+{
+    traceRecording.store(false, std::memory_order_release);
+
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        LOG_ERROR("Failed to open trace file {}", path);
+        return false;
+    }
+
+    const std::thread::id callingThread = std::this_thread::get_id();
+    size_t eventCount = 0;
+    bool first = true;
+    file << "{\"traceEvents\":[\n";
+
+    std::lock_guard lock(registryMutex);
+    for (size_t tid = 0; tid < threadBuffers.size(); tid++)
+    {
+        ThreadTraceBuffer& buffer = *threadBuffers[tid];
+        std::lock_guard bufferLock(buffer.mutex);
+
+        if (!first) file << ",\n";
+        first = false;
+        file << R"({"name":"thread_name","ph":"M","pid":0,"tid":)" << tid << R"(,"args":{"name":")";
+        if (buffer.threadID == callingThread)
+            file << "Main Thread";
+        else
+            file << "Thread " << tid;
+        file << "\"}}";
+
+        for (const auto& event : buffer.events)
+        {
+            file << ",\n" << R"({"name":")" << event.name << R"(","cat":")" << event.category
+                 << R"(","ph":"X","pid":0,"tid":)" << tid << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs;
+            if (event.hasChunk)
+                file << R"(,"args":{"chunk":")" << event.chunkPosition.x << ' ' << event.chunkPosition.y << ' ' << event.chunkPosition.z << "\"}";
+            file << '}';
+        }
+
+        eventCount += buffer.events.size();
+        buffer.events.clear();
+    }
+
+    file << "\n]}\n";
+    LOG_INFO("Trace with {} events written to {}", eventCount, path);
+    return true;
+}
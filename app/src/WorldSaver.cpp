@@ -0,0 +1,132 @@
+#include "WorldSaver.h"
+#include "SQLiteCpp/Statement.h"
+
+WorldSaver::WorldSaver(const std::string& dbPath, const uint32_t compactionThreshold, const uint32_t worldSeed)
+    :   dbPath(dbPath),
+        compactionThreshold(compactionThreshold),
+        worldGenData(worldSeed),
+        thread([this](const std::stop_token& st) { threadLoop(st); })
+{
+}
+
+void WorldSaver::requestCompaction(const glm::ivec3& chunkPos)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!pendingCompactions.insert(chunkPos).second)
+            return;
+        compactionRequests.push(chunkPos);
+    }
+    queueCondition.notify_one();
+}
+
+void WorldSaver::queueSnapshots(std::vector<ChunkSnapshot>&& chunkSnapshots)
+{
+    if (chunkSnapshots.empty())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (auto& snapshot : chunkSnapshots)
+        {
+            unsavedSnapshots[snapshot.chunkPosition] = snapshot.blocks;
+            snapshots.push(std::move(snapshot));
+        }
+    }
+    queueCondition.notify_one();
+}
+
+std::shared_ptr<const Chunk::BlockStorage> WorldSaver::findUnsaved(const glm::ivec3& chunkPos) const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    const auto it = unsavedSnapshots.find(chunkPos);
+    if (it != unsavedSnapshots.end())
+        return it->second;
+    return nullptr;
+}
+
+static void saveSnapshot(SQLite::Database& db, const ChunkSnapshot& snapshot, const WorldGenerationData& worldGenData, Chunk::BlockStorage& terrain, std::vector<BLOCK_TYPE>& changes)
+{
+    // only the difference to the generated terrain is stored
+    generateTerrain(terrain, snapshot.chunkPosition, worldGenData);
+
+    const Chunk::BlockStorage& blocks = *snapshot.blocks;
+    for (int32_t i = 0; i < Chunk::BLOCKS_PER_CHUNK; i++)
+        changes[i] = blocks[i] == terrain[i] ? BLOCK_TYPE::INVALID : blocks[i];
+
+    saveChunkDiff(db, snapshot.chunkPosition, changes);
+}
+
+void WorldSaver::threadLoop(const std::stop_token& st)
+{
+    SQLite::Database db = initDB(dbPath);
+
+    // journals of saves from older versions may already be over the threshold
+    {
+        SQLite::Statement query(db, "SELECT chunkX, chunkY, chunkZ FROM BlockChange GROUP BY chunkX, chunkY, chunkZ HAVING COUNT(*) >= ?");
+        query.bind(1, int(compactionThreshold));
+        while (query.executeStep())
+            requestCompaction({query.getColumn(0).getInt(), query.getColumn(1).getInt(), query.getColumn(2).getInt()});
+    }
+
+    const auto terrain = std::make_unique<Chunk::BlockStorage>();
+    std::vector<BLOCK_TYPE> changes(Chunk::BLOCKS_PER_CHUNK);
+
+    while (true)
+    {
+        std::optional<ChunkSnapshot> snapshot;
+        glm::ivec3 compactionPos;
+
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, st, [this] { return !snapshots.empty() || !compactionRequests.empty(); });
+
+            // snapshots are always written before stopping, compactions can wait for the next session
+            if (!snapshots.empty())
+            {
+                snapshot = std::move(snapshots.front());
+                snapshots.pop();
+            }
+            else if (st.stop_requested())
+                return;
+            else if (!compactionRequests.empty())
+            {
+                compactionPos = compactionRequests.front();
+                compactionRequests.pop();
+                pendingCompactions.erase(compactionPos);
+            }
+            else
+                continue;
+        }
+
+        if (snapshot)
+        {
+            const glm::ivec3& pos = snapshot->chunkPosition;
+            try
+            {
+                saveSnapshot(db, *snapshot, worldGenData, *terrain, changes);
+            }
+            catch (const SQLite::Exception& e)
+            {
+                LOG_ERROR("Saving chunk ({}, {}, {}) failed: {}", pos.x, pos.y, pos.z, e.what());
+            }
+
+            std::lock_guard<std::mutex> lock(queueMutex);
+            const auto it = unsavedSnapshots.find(pos);
+            if (it != unsavedSnapshots.end() && it->second == snapshot->blocks)
+                unsavedSnapshots.erase(it);
+        }
+        else
+        {
+            try
+            {
+                if (compactBlockChanges(db, compactionPos, compactionThreshold))
+                    LOG_INFO("Compacted block changes of chunk ({}, {}, {})", compactionPos.x, compactionPos.y, compactionPos.z);
+            }
+            catch (const SQLite::Exception& e)
+            {
+                LOG_WARN("Compaction of chunk ({}, {}, {}) failed: {}", compactionPos.x, compactionPos.y, compactionPos.z, e.what());
+            }
+        }
+    }
+}
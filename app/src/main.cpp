@@ -2,6 +2,7 @@
 #include "ControlLayer.h"
 #include "DebugLayer.h"
 #include "GameLayer.h"
+#include "Trace.h"
 #include "cstmlib/Log.h"
 #include "cstmlib/Profiling.h"
 
@@ -33,6 +34,9 @@ int main(int argc, char* argv[])
     app.pushLayer<core::Application::TOP, ControlLayer>("ControlLayer");
     app.run();
 
+    if (isTraceRecording())
+        stopTraceRecording(TRACE_PATH);
+
     PROFILER_END();
     return 0;
 }
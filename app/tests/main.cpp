@@ -1,9 +1,13 @@
+#include <filesystem>
 #include <gtest/gtest.h>
 #include <cstmlib/Profiling.h>
 #include <cstmlib/Log.h>
 
 #include "Application.h"
 #include "Chunk.h"
+#include "Lighting.h"
+#include "MeshCache.h"
+#include "MeshUploader.h"
 
 class TestClass : public testing::Test
 {
@@ -11,6 +15,9 @@ protected:
     void SetUp() override {}
 };
 
+// the defaults, the profiles don't read the config file
+const GameConfig gameConfig;
+
 void profileChunkGen()
 {
     const WorldGenerationData worldGenData(0);
@@ -63,7 +70,10 @@ void profileBaking()
                 chunkManager.getChunk(pos + glm::ivec3{0, -1, 0}),
                 chunkManager.getChunk(pos + glm::ivec3{0, 1, 0})
             };
-        chunk.generateMeshData(neighbours2);
+        std::array<Chunk*, 20> diagonals2;
+        for (uint32_t i = 0; i < diagonals2.size(); i++)
+            diagonals2[i] = chunkManager.getChunk(pos + DIAGONAL_OFFSETS[i]);
+        chunk.generateMeshData(neighbours2, diagonals2);
     }), Chunk::BLOCKS_PER_CHUNK, 100, 100);
     LOG_INFO("Chunk Mesh Baking (with neighbours fetched live and populated map) ---------\n{}", std::string(res));
 
@@ -73,6 +83,467 @@ void profileBaking()
     }
 }
 
+void profileAutosaveSnapshot()
+{
+    const WorldGenerationData worldGenData(0);
+    ChunkManager chunkManager(gameConfig);
+    for (int32_t x = -8; x < 8; x++)
+        for (int32_t z = -8; z < 8; z++)
+            chunkManager.chunks.emplace(glm::ivec3{x, 0, z}, Chunk(glm::ivec3{x, 0, z}, worldGenData));
+
+    // every chunk edited since the last autosave, the snapshot itself must stay well below 0.5 ms
+    const auto res = REP_TEST(([&]()
+    {
+        for (auto& [pos, chunk] : chunkManager.chunks)
+        {
+            chunk.setBlockUnsafe(glm::ivec3{0}, BLOCK_TYPE::STONE);
+            chunkManager.markDirty(chunk);
+        }
+        const auto snapshots = chunkManager.snapshotDirtyChunks();
+    }), chunkManager.chunks.size(), 100, 100);
+    LOG_INFO("Autosave Snapshot (256 dirty chunks, includes the copy-on-write of the edit) ---------\n{}", std::string(res));
+}
+
+// Needs a GL 3.3 context that can share objects, Mesa llvmpipe is enough
+TEST(MeshUploader, UploadedBuffersMatchMeshData)
+{
+    SharedContext context = core::Application::get().getWindow().createSharedContext();
+    ASSERT_TRUE(context);
+    MeshUploader uploader(std::move(context));
+
+    MeshUpload upload{glm::ivec3{1, 2, 3}, 7};
+    for (uint32_t i = 0; i < 1000; i++)
+        upload.meshDataOpaque.push_back(i * 31);
+    upload.meshDataTranslucent.push_back(42);
+    const Chunk::MeshData expectedOpaque = upload.meshDataOpaque;
+    uploader.queueUpload(std::move(upload));
+
+    std::vector<UploadedMesh> finished;
+    const auto start = std::chrono::steady_clock::now();
+    while (finished.empty() && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+    {
+        finished = uploader.collectUploads();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_EQ(finished.size(), 1u);
+
+    const UploadedMesh& mesh = finished[0];
+    EXPECT_EQ(mesh.position, glm::ivec3(1, 2, 3));
+    EXPECT_EQ(mesh.meshRevision, 7u);
+    EXPECT_EQ(mesh.vertexCountOpaque, 1000u);
+    EXPECT_EQ(mesh.vertexCountTranslucent, 1u);
+
+    // the fence has signalled, the main context sees the data the upload thread wrote
+    std::vector<blockdata> readBack(mesh.vertexCountOpaque);
+    glBindBuffer(GL_COPY_READ_BUFFER, mesh.bufferOpaque);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, GLsizeiptr(readBack.size() * sizeof(blockdata)), readBack.data());
+    EXPECT_TRUE(std::equal(readBack.begin(), readBack.end(), expectedOpaque.begin()));
+
+    deleteUploadedMesh(mesh);
+}
+
+// Needs the GL context, the only worker is held up so the first sort is still pending when the remesh lands
+TEST(ChunkManager, ResortsMeshUploadedWhileSortIsPending)
+{
+    GameConfig config;
+    config.meshCacheMB = 0;
+    config.threadCount = 1;
+    ChunkManager chunkManager(config);
+    const glm::ivec3 pos{0, 0, 0};
+    Chunk newChunk;
+    newChunk.chunkPosition = pos;
+    chunkManager.chunks.emplace(pos, std::move(newChunk));
+    Chunk& chunk = *chunkManager.getChunk(pos);
+
+    // a row of water faces along x in mesh order, seen from -x the back to front order is reversed
+    const auto uploadMesh = [&](const uint32_t faceCount)
+    {
+        chunk.invalidateMesh();
+        for (uint32_t x = 0; x < faceCount; x++)
+            chunk.meshDataTranslucent.push_back(packBlockData({x, 5, 5}, {0, 0}, TOP, 15, 0));
+        chunk.isMeshDataReady = true;
+        chunkManager.uploadQueue.push_back(pos);
+        EXPECT_EQ(chunkManager.uploadMeshes(1), 1u);
+    };
+    const glm::vec3 cameraPos{-40.0f, 16.0f, 16.0f};
+
+    std::atomic<bool> released = false;
+    chunkManager.threadPool.queueJob([&]()
+    {
+        while (!released)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }, -1.0f);
+    uploadMesh(4);
+    chunkManager.sortTranslucentFaces(cameraPos);
+    EXPECT_TRUE(chunk.isSortPending);
+    uploadMesh(6);
+    EXPECT_EQ(chunkManager.sortTranslucentFaces(cameraPos), 0u);
+    released = true;
+
+    const auto start = std::chrono::steady_clock::now();
+    while ((!chunk.isTranslucentSorted || chunk.isSortPending) && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+    {
+        chunkManager.sortTranslucentFaces(cameraPos);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ASSERT_TRUE(chunk.isTranslucentSorted);
+    EXPECT_EQ(chunk.translucentRevision, chunk.meshRevision);
+
+    std::vector<blockdata> readBack(chunk.vaoTranslucent.vertexCount);
+    ASSERT_EQ(readBack.size(), 6u);
+    glBindBuffer(GL_COPY_READ_BUFFER, chunk.vaoTranslucent.buffers[0]);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, GLsizeiptr(readBack.size() * sizeof(blockdata)), readBack.data());
+    for (uint32_t i = 0; i < readBack.size(); i++)
+        EXPECT_EQ(unpackBlockPosition(readBack[i]).x, 5 - i);
+    // the job gave the copy back
+    EXPECT_EQ(chunk.translucentFaces.size(), 6u);
+
+    // leaving the chunk behind drops the copy, coming back remeshes it instead of reading the buffer back
+    chunkManager.sortTranslucentFaces({-400.0f, 16.0f, 16.0f});
+    EXPECT_TRUE(chunk.translucentFaces.empty());
+    EXPECT_TRUE(chunk.isMeshBaked);
+    chunkManager.sortTranslucentFaces(cameraPos);
+    EXPECT_FALSE(chunk.isMeshBaked);
+    EXPECT_NE(std::find(chunkManager.meshQueue.begin(), chunkManager.meshQueue.end(), pos), chunkManager.meshQueue.end());
+}
+
+TEST(ChunkManager, EditsOnlyRemeshNeighboursThatReadTheBlock)
+{
+    GameConfig config;
+    config.meshCacheMB = 0;
+    ChunkManager chunkManager(config);
+    const WorldGenerationData worldGenData(0);
+    const glm::ivec3 center{0, 1, 0};
+    const std::array<glm::ivec3, 6> offsets{{{0, 0, -1}, {0, 0, 1}, {-1, 0, 0}, {1, 0, 0}, {0, -1, 0}, {0, 1, 0}}};
+    chunkManager.chunks.emplace(center, Chunk(center, worldGenData));
+    for (const auto& offset : offsets)
+        chunkManager.chunks.emplace(center + offset, Chunk(center + offset, worldGenData));
+
+    const auto editAndGetRemeshed = [&](const glm::ivec3& positionInChunk)
+    {
+        std::array<uint32_t, 6> revisions;
+        for (uint32_t face = 0; face < 6; face++)
+            revisions[face] = chunkManager.getChunk(center + offsets[face])->meshRevision;
+        chunkManager.setBlock(*chunkManager.getChunk(center), positionInChunk, BLOCK_TYPE::STONE);
+
+        std::vector<uint32_t> remeshed;
+        for (uint32_t face = 0; face < 6; face++)
+            if (chunkManager.getChunk(center + offsets[face])->meshRevision != revisions[face])
+                remeshed.push_back(face);
+        return remeshed;
+    };
+
+    EXPECT_EQ(editAndGetRemeshed({5, 5, 5}), std::vector<uint32_t>{});
+    EXPECT_EQ(editAndGetRemeshed({0, 5, 5}), std::vector<uint32_t>{LEFT});
+    EXPECT_EQ(editAndGetRemeshed({31, 31, 0}), (std::vector<uint32_t>{BACK, RIGHT, TOP}));
+
+    // the corner occlusion of the chunks across an edge or corner reads the blocks along it
+    const glm::ivec3 edge = center + glm::ivec3{1, 1, 0}, corner = center + glm::ivec3{1, 1, -1};
+    chunkManager.chunks.emplace(edge, Chunk(edge, worldGenData));
+    chunkManager.chunks.emplace(corner, Chunk(corner, worldGenData));
+    const auto editAndGetRemeshedDiagonals = [&](const glm::ivec3& positionInChunk)
+    {
+        const uint32_t edgeRevision = chunkManager.getChunk(edge)->meshRevision, cornerRevision = chunkManager.getChunk(corner)->meshRevision;
+        chunkManager.setBlock(*chunkManager.getChunk(center), positionInChunk, BLOCK_TYPE::STONE);
+        return std::pair(chunkManager.getChunk(edge)->meshRevision != edgeRevision, chunkManager.getChunk(corner)->meshRevision != cornerRevision);
+    };
+    EXPECT_EQ(editAndGetRemeshedDiagonals({31, 5, 5}), std::pair(false, false));
+    EXPECT_EQ(editAndGetRemeshedDiagonals({31, 31, 5}), std::pair(true, false));
+    EXPECT_EQ(editAndGetRemeshedDiagonals({31, 31, 0}), std::pair(true, true));
+
+    // 2x meshes read two blocks deep, neighbours at another level don't read the chunk at all
+    for (auto& [_, chunk] : chunkManager.chunks)
+        chunk.lod = 1;
+    EXPECT_EQ(editAndGetRemeshed({1, 5, 5}), std::vector<uint32_t>{LEFT});
+    chunkManager.getChunk(center + offsets[LEFT])->lod = 0;
+    EXPECT_EQ(editAndGetRemeshed({0, 5, 5}), std::vector<uint32_t>{});
+}
+
+static uint32_t getLightIndex(const glm::ivec3& pos) { return pos.x + pos.y * Chunk::CHUNK_SIZE + pos.z * Chunk::CHUNK_SIZE * Chunk::CHUNK_SIZE; }
+static uint8_t getBlockLight(const Chunk& chunk, const glm::ivec3& pos) { return chunk.light.get(getLightIndex(pos)) >> BLOCK_LIGHT_SHIFT; }
+
+TEST(Lighting, FillsSkyAndLampLight)
+{
+    Chunk::BlockStorage blocks;
+    blocks.fill(BLOCK_TYPE::AIR);
+    Chunk::LightStorage light;
+    fillChunkLight(blocks, {}, true, light);
+    EXPECT_EQ(light.voxels, nullptr);
+    EXPECT_EQ(light.uniform, OPEN_SKY_LIGHT);
+
+    // sky light keeps its level straight down from a lit chunk above, without it the chunk is dark
+    Chunk::LightStorage above;
+    above.uniform = OPEN_SKY_LIGHT;
+    fillChunkLight(blocks, {nullptr, nullptr, nullptr, nullptr, nullptr, &above}, false, light);
+    EXPECT_EQ(light.uniform, OPEN_SKY_LIGHT);
+    fillChunkLight(blocks, {}, false, light);
+    EXPECT_EQ(light.voxels, nullptr);
+    EXPECT_EQ(light.uniform, 0);
+
+    // a lamp in a tunnel through rock loses a level per block
+    blocks.fill(BLOCK_TYPE::STONE);
+    for (int32_t x = 0; x < Chunk::CHUNK_SIZE; x++)
+        blocks[getLightIndex({x, 5, 5})] = BLOCK_TYPE::AIR;
+    blocks[getLightIndex({10, 5, 5})] = BLOCK_TYPE::LAMP;
+    fillChunkLight(blocks, {}, true, light);
+    ASSERT_NE(light.voxels, nullptr);
+    EXPECT_EQ(light.get(getLightIndex({10, 5, 5})), 14 << BLOCK_LIGHT_SHIFT);
+    EXPECT_EQ(light.get(getLightIndex({13, 5, 5})), 11 << BLOCK_LIGHT_SHIFT);
+    EXPECT_EQ(light.get(getLightIndex({0, 5, 5})), 4 << BLOCK_LIGHT_SHIFT);
+    EXPECT_EQ(light.get(getLightIndex({10, 6, 5})), 0);
+}
+
+TEST(Lighting, EditsRelightOnlyWhatChangesAcrossChunks)
+{
+    GameConfig config;
+    config.meshCacheMB = 0;
+    ChunkManager chunkManager(config);
+    // a tunnel along x through two chunks of rock
+    for (const glm::ivec3 pos : {glm::ivec3{0, 0, 0}, glm::ivec3{1, 0, 0}})
+    {
+        Chunk chunk;
+        chunk.chunkPosition = pos;
+        chunk.blocks->fill(BLOCK_TYPE::STONE);
+        for (int32_t x = 0; x < Chunk::CHUNK_SIZE; x++)
+            (*chunk.blocks)[getLightIndex({x, 5, 5})] = BLOCK_TYPE::AIR;
+        chunkManager.chunks.emplace(pos, std::move(chunk));
+    }
+    for (auto& [_, chunk] : chunkManager.chunks)
+    {
+        Chunk::LightStorage light;
+        fillChunkLight(*chunk.blocks, {}, false, light);
+        chunkManager.setChunkLight(chunk, std::move(light));
+    }
+
+    Chunk& left = *chunkManager.getChunk({0, 0, 0});
+    const Chunk& right = *chunkManager.getChunk({1, 0, 0});
+    const uint32_t rightRevision = right.meshRevision;
+    chunkManager.setBlock(left, {30, 5, 5}, BLOCK_TYPE::LAMP);
+    EXPECT_EQ(getBlockLight(left, {30, 5, 5}), 14);
+    EXPECT_EQ(getBlockLight(left, {17, 5, 5}), 1);
+    EXPECT_EQ(getBlockLight(right, {0, 5, 5}), 12);
+    EXPECT_EQ(getBlockLight(right, {11, 5, 5}), 1);
+    EXPECT_EQ(getBlockLight(right, {12, 5, 5}), 0);
+    // the lamp and the 13 lit blocks on either side
+    EXPECT_EQ(chunkManager.lastRelitVoxels, 27u);
+    EXPECT_NE(right.meshRevision, rightRevision);
+
+    // taking it out removes exactly that light again
+    chunkManager.setBlock(left, {30, 5, 5}, BLOCK_TYPE::AIR);
+    EXPECT_EQ(chunkManager.lastRelitVoxels, 27u);
+    for (int32_t x = 0; x < Chunk::CHUNK_SIZE; x++)
+    {
+        EXPECT_EQ(left.light.get(getLightIndex({x, 5, 5})), 0);
+        EXPECT_EQ(right.light.get(getLightIndex({x, 5, 5})), 0);
+    }
+    EXPECT_EQ(chunkManager.relights, 2u);
+
+    // rock that doesn't touch the light doesn't relight anything
+    chunkManager.setBlock(left, {20, 20, 20}, BLOCK_TYPE::SAND);
+    EXPECT_EQ(chunkManager.relights, 2u);
+}
+
+TEST(Lighting, CorrectsOpenSkyOnceChunkAboveIsLit)
+{
+    GameConfig config;
+    config.meshCacheMB = 0;
+    ChunkManager chunkManager(config);
+    // a cave lit before the rock above it was loaded, with a shaft down at x = z = 5
+    Chunk cave, rock;
+    cave.chunkPosition = {0, 0, 0};
+    cave.blocks->fill(BLOCK_TYPE::AIR);
+    rock.chunkPosition = {0, 1, 0};
+    rock.blocks->fill(BLOCK_TYPE::STONE);
+    for (int32_t y = 0; y < Chunk::CHUNK_SIZE; y++)
+        (*rock.blocks)[getLightIndex({5, y, 5})] = BLOCK_TYPE::AIR;
+    chunkManager.chunks.emplace(cave.chunkPosition, std::move(cave));
+    chunkManager.chunks.emplace(rock.chunkPosition, std::move(rock));
+
+    Chunk& caveChunk = *chunkManager.getChunk({0, 0, 0});
+    Chunk::LightStorage light;
+    fillChunkLight(*caveChunk.blocks, {}, true, light);
+    caveChunk.hasAssumedSky = true;
+    chunkManager.setChunkLight(caveChunk, std::move(light));
+    EXPECT_EQ(caveChunk.light.get(getLightIndex({20, 20, 20})), OPEN_SKY_LIGHT);
+
+    Chunk& rockChunk = *chunkManager.getChunk({0, 1, 0});
+    fillChunkLight(*rockChunk.blocks, {}, true, light);
+    chunkManager.setChunkLight(rockChunk, std::move(light));
+    EXPECT_FALSE(caveChunk.hasAssumedSky);
+    // only the shaft lets the sky in, it spreads a level less per block from there
+    EXPECT_EQ(caveChunk.light.get(getLightIndex({5, 0, 5})), OPEN_SKY_LIGHT);
+    EXPECT_EQ(caveChunk.light.get(getLightIndex({6, 31, 5})), OPEN_SKY_LIGHT - 1);
+    EXPECT_EQ(caveChunk.light.get(getLightIndex({8, 20, 5})), OPEN_SKY_LIGHT - 3);
+    EXPECT_EQ(caveChunk.light.get(getLightIndex({20, 20, 20})), 0);
+}
+
+static uint8_t findOcclusion(const Chunk::MeshData& faces, const glm::uvec3& pos, const FACE face)
+{
+    for (const blockdata data : faces)
+        if (unpackBlockFace(data) == face && unpackBlockPosition(data) == pos)
+            return unpackBlockOcclusion(data);
+    ADD_FAILURE() << "no face at " << pos.x << " " << pos.y << " " << pos.z;
+    return 0;
+}
+
+static uint8_t packCorners(const uint32_t c0, const uint32_t c1, const uint32_t c2, const uint32_t c3)
+{
+    return uint8_t(c0 | c1 << 2 | c2 << 4 | c3 << 6);
+}
+
+TEST(Meshing, BakesCornerOcclusion)
+{
+    // a stone floor with a few blocks on it, and a block in the chunk to the left next to the floor's edge
+    Chunk::BlockStorage blocks, left;
+    blocks.fill(BLOCK_TYPE::AIR);
+    left.fill(BLOCK_TYPE::AIR);
+    for (int32_t z = 0; z < Chunk::CHUNK_SIZE; z++)
+        for (int32_t x = 0; x < Chunk::CHUNK_SIZE; x++)
+            blocks[getLightIndex({x, 0, z})] = BLOCK_TYPE::STONE;
+    blocks[getLightIndex({10, 1, 10})] = BLOCK_TYPE::STONE;
+    blocks[getLightIndex({21, 1, 20})] = BLOCK_TYPE::STONE;
+    blocks[getLightIndex({20, 1, 21})] = BLOCK_TYPE::STONE;
+    blocks[getLightIndex({5, 1, 5})] = BLOCK_TYPE::WATER;
+    left[getLightIndex({31, 1, 5})] = BLOCK_TYPE::STONE;
+    // blocks under the top edge and corner next to the left neighbour, and the chunks diagonal to those
+    Chunk::BlockStorage edge, corner;
+    edge.fill(BLOCK_TYPE::AIR);
+    corner.fill(BLOCK_TYPE::AIR);
+    blocks[getLightIndex({0, 31, 7})] = BLOCK_TYPE::STONE;
+    blocks[getLightIndex({0, 31, 0})] = BLOCK_TYPE::STONE;
+    edge[getLightIndex({31, 0, 7})] = BLOCK_TYPE::STONE;
+    corner[getLightIndex({31, 0, 31})] = BLOCK_TYPE::STONE;
+    std::array<const Chunk::BlockStorage*, 20> diagonals{};
+    for (uint32_t i = 0; i < diagonals.size(); i++)
+    {
+        if (DIAGONAL_OFFSETS[i] == glm::ivec3{-1, 1, 0})
+            diagonals[i] = &edge;
+        else if (DIAGONAL_OFFSETS[i] == glm::ivec3{-1, 1, -1})
+            diagonals[i] = &corner;
+    }
+
+    Chunk::LightStorage light;
+    light.uniform = OPEN_SKY_LIGHT;
+    Chunk::MeshData opaque, translucent;
+    Chunk::FaceCounts faceCounts;
+    generateMeshData(blocks, {nullptr, nullptr, &left, nullptr, nullptr, nullptr}, diagonals, light, {}, opaque, translucent, faceCounts);
+
+    // top corners run (0,0), (1,0), (1,1), (0,1) in x and z
+    EXPECT_EQ(findOcclusion(opaque, {15, 0, 15}, TOP), NO_OCCLUSION);
+    EXPECT_EQ(findOcclusion(opaque, {11, 0, 10}, TOP), packCorners(2, 3, 3, 2));
+    EXPECT_EQ(findOcclusion(opaque, {11, 0, 11}, TOP), packCorners(2, 3, 3, 3));
+    // both sides of a corner blocked is fully occluded whatever is diagonal to it
+    EXPECT_EQ(findOcclusion(opaque, {20, 0, 20}, TOP), packCorners(3, 2, 0, 2));
+    // water lets the light through
+    EXPECT_EQ(findOcclusion(opaque, {6, 0, 5}, TOP), NO_OCCLUSION);
+    // the neighbour's border slab counts, missing neighbours don't
+    EXPECT_EQ(findOcclusion(opaque, {0, 0, 5}, TOP), packCorners(2, 3, 3, 2));
+    EXPECT_EQ(findOcclusion(opaque, {31, 0, 5}, TOP), NO_OCCLUSION);
+    // the floor is beside and diagonal to the lower corners of a block standing on it
+    EXPECT_EQ(findOcclusion(opaque, {10, 1, 10}, RIGHT), packCorners(1, 1, 3, 3));
+    // the chunks across the edge and the corner shade too, no seam along chunk edges
+    EXPECT_EQ(findOcclusion(opaque, {0, 31, 7}, TOP), packCorners(2, 3, 3, 2));
+    EXPECT_EQ(findOcclusion(opaque, {0, 31, 0}, TOP), packCorners(2, 3, 3, 3));
+
+    generateMeshData(blocks, {nullptr, nullptr, &left, nullptr, nullptr, nullptr}, {}, light, {}, opaque, translucent, faceCounts);
+    EXPECT_EQ(findOcclusion(opaque, {0, 31, 7}, TOP), NO_OCCLUSION);
+}
+
+TEST(MeshCache, KeyCoversBordersAndLevel)
+{
+    const WorldGenerationData worldGenData(0);
+    const Chunk chunk({0, 1, 0}, worldGenData), neighbour({1, 1, 0}, worldGenData);
+    std::array<const Chunk::BlockStorage*, 6> neighbours{};
+    std::array<const Chunk::BlockStorage*, 20> diagonals{};
+    Chunk::LightStorage light;
+    std::array<const Chunk::LightStorage*, 6> neighbourLight{};
+    const MeshCacheKey alone = hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0);
+    EXPECT_EQ(alone, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0));
+    EXPECT_NE(alone, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 1));
+
+    neighbours[RIGHT] = neighbour.blocks.get();
+    const MeshCacheKey bordered = hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0);
+    EXPECT_NE(alone, bordered);
+
+    // the right neighbour is only read at x = 0 at full detail, at x < 2 for the 2x level
+    const auto flip = [](const BLOCK_TYPE block) { return block == BLOCK_TYPE::STONE ? BLOCK_TYPE::AIR : BLOCK_TYPE::STONE; };
+    Chunk::BlockStorage edited = *neighbour.blocks;
+    edited[1] = flip(edited[1]);
+    neighbours[RIGHT] = &edited;
+    EXPECT_EQ(bordered, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0));
+    neighbours[RIGHT] = neighbour.blocks.get();
+    const MeshCacheKey borderedLod = hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 1);
+    neighbours[RIGHT] = &edited;
+    EXPECT_NE(borderedLod, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 1));
+    edited[0] = flip(edited[0]);
+    EXPECT_NE(bordered, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0));
+
+    // light only counts at full detail, of the neighbours only the cells next to the chunk
+    const MeshCacheKey dark = hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0);
+    const MeshCacheKey darkLod = hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 1);
+    light.set(5, OPEN_SKY_LIGHT);
+    EXPECT_NE(dark, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0));
+    EXPECT_EQ(darkLod, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 1));
+
+    Chunk::LightStorage rightLight;
+    neighbourLight[RIGHT] = &rightLight;
+    const MeshCacheKey litBorder = hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0);
+    rightLight.set(1, OPEN_SKY_LIGHT);
+    EXPECT_EQ(litBorder, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0));
+    rightLight.set(0, OPEN_SKY_LIGHT);
+    EXPECT_NE(litBorder, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0));
+
+    // a diagonal neighbour only counts at full detail, with just the row along the shared edge
+    const MeshCacheKey noDiagonal = hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0);
+    const MeshCacheKey noDiagonalLod = hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 1);
+    Chunk::BlockStorage diagonal;
+    diagonal.fill(BLOCK_TYPE::AIR);
+    // DIAGONAL_OFFSETS[0] is {-1, -1, 0}, it touches the chunk along its row at x = 31, y = 31
+    diagonals[0] = &diagonal;
+    const MeshCacheKey withDiagonal = hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0);
+    EXPECT_NE(noDiagonal, withDiagonal);
+    EXPECT_EQ(noDiagonalLod, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 1));
+    diagonal[getLightIndex({30, 31, 4})] = BLOCK_TYPE::STONE;
+    EXPECT_EQ(withDiagonal, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0));
+    diagonal[getLightIndex({31, 31, 4})] = BLOCK_TYPE::STONE;
+    EXPECT_NE(withDiagonal, hashPaddedVolume(*chunk.blocks, neighbours, diagonals, light, neighbourLight, 0));
+}
+
+TEST(MeshCache, EvictsLeastRecentlyUsedAndKeepsThemInTheFile)
+{
+    const std::string path = (std::filesystem::temp_directory_path() / "VoxelGame_meshcache_test.db").string();
+    std::filesystem::remove(path);
+
+    GeneratedMesh mesh;
+    mesh.meshDataOpaque.assign(1000, 7);
+    mesh.faceCountsOpaque = {1000, 0, 0, 0, 0, 0};
+    const size_t entryBytes = sizeof(MeshCache::Entry) + 1000 * sizeof(blockdata);
+    {
+        MeshCache cache(2 * entryBytes, path, 1 << 20);
+        cache.insert({1, 1}, mesh, 2.0f);
+        cache.insert({2, 2}, mesh, 3.0f);
+        GeneratedMesh found;
+        ASSERT_TRUE(cache.find({1, 1}, found).has_value());
+        cache.insert({3, 3}, mesh, 4.0f);
+        EXPECT_EQ(cache.index.size(), 2u);
+        EXPECT_FALSE(cache.index.contains({2, 2}));
+    }
+
+    // the evicted entry comes back from the file in the next session
+    {
+        MeshCache reopened(2 * entryBytes, path, 1 << 20);
+        GeneratedMesh found;
+        const std::optional<float> meshMs = reopened.find({2, 2}, found);
+        ASSERT_TRUE(meshMs.has_value());
+        EXPECT_FLOAT_EQ(*meshMs, 3.0f);
+        EXPECT_TRUE(std::equal(found.meshDataOpaque.begin(), found.meshDataOpaque.end(), mesh.meshDataOpaque.begin(), mesh.meshDataOpaque.end()));
+        EXPECT_EQ(found.faceCountsOpaque, mesh.faceCountsOpaque);
+        EXPECT_EQ(reopened.fileHits.load(), 1u);
+        EXPECT_FALSE(reopened.find({4, 4}, found).has_value());
+    }
+    std::filesystem::remove(path);
+}
+
 int main(int argc, char **argv)
 {
     LOG_INIT();
@@ -81,6 +552,7 @@ int main(int argc, char **argv)
     core::Application app(settings);
     profileChunkGen();
     profileBaking();
+    profileAutosaveSnapshot();
     PROFILER_END();
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
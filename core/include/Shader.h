@@ -11,6 +11,18 @@ class Shader
 public:
     Shader(const char* pVertexShaderSource, const char* pFragmentShaderSource, const char* pGeometryShaderSource = nullptr);
     ~Shader();
+    // location of an active uniform, resolved once when the program was linked. -1 if the program has
+    // none of that name, the setters then do nothing, just like glUniform* does.
+    GLint getUniform(const std::string& name) const;
+    // points a uniform block at the buffer bound to bindingPoint (GLSL 330 has no binding layout qualifier)
+    void bindUniformBlock(const char* blockName, GLuint bindingPoint) const;
+    void setUniform1f(GLint location, float value);
+    void setUniformMat4(GLint location, const glm::mat4& mat);
+    void setUniform3f(GLint location, const glm::vec3& vec);
+    void setUniform1i(GLint location, int value);
+    void setUniform1u(GLint location, unsigned int value);
+    void setUniform2u(GLint location, unsigned int x, unsigned int y);
+    // by name, for uniforms set once or rarely. Hot paths keep the handle from getUniform.
     void setUniform1f(const std::string& name, float value);
     void setUniformMat4(const std::string& name, const glm::mat4& mat);
     void setUniform3f(const std::string& name, const glm::vec3& vec);
@@ -20,8 +32,8 @@ public:
     void bind() const;
     void unbind() const;
 private:
-    GLint getUniformLocation(const std::string& name);
+    void resolveUniforms();
 private:
     GLuint m_ID;
-    std::pmr::unordered_map<std::string, GLuint> m_UniformLocations;
+    std::unordered_map<std::string, GLint> m_UniformLocations;
 };
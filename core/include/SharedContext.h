@@ -0,0 +1,16 @@
+#pragma once
+
+#include <functional>
+
+// GL context sharing objects with a window's, for a thread that uploads in the background. Window::createSharedContext
+// makes it, code that only holds one links without GLFW.
+struct SharedContext
+{
+    // binds the context to the calling thread, or unbinds whatever context is bound there
+    std::function<void(bool current)> makeCurrent;
+    // on the main thread, once no thread has the context current anymore
+    std::function<void()> destroy;
+
+    // false if the context couldn't be created
+    explicit operator bool() const { return bool(destroy); }
+};
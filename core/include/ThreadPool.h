@@ -1,24 +1,45 @@
 #pragma once
+#include <atomic>
 #include <condition_variable>
 #include <functional>
+#include <memory>
 #include <queue>
 #include <thread>
 
+// Shared between whoever queued a job and the job itself, a job whose token is set is dropped before it starts.
+// Long running jobs may also poll it to stop early.
+using CancellationToken = std::shared_ptr<std::atomic<bool>>;
+inline CancellationToken makeCancellationToken() { return std::make_shared<std::atomic<bool>>(false); }
+
 // https://stackoverflow.com/questions/15752659/thread-pooling-in-c11
 struct ThreadPool
 {
+    struct Job
+    {
+        std::function<void()> func;
+        // lower runs first, equal priorities run in queue order
+        float priority;
+        uint64_t order;
+        CancellationToken token;
+
+        bool operator<(const Job& other) const { return priority != other.priority ? priority > other.priority : order > other.order; }
+    };
+
     explicit ThreadPool(uint32_t numThreads = std::thread::hardware_concurrency());
     ~ThreadPool();
-    void queueJob(const std::function<void()>& job);
+    void queueJob(const std::function<void()>& job, float priority = 0.0f, CancellationToken token = nullptr);
     void stop();
     bool busy();
     uint32_t getThreadCount() const { return threads.size(); }
 
     std::vector<std::jthread> threads;
-    std::queue<std::function<void()>> jobs;
+    std::priority_queue<Job> jobs;
+    uint64_t jobsQueued = 0;
     std::mutex queueMutex;
     std::condition_variable mutexCondition;
     std::atomic<uint32_t> busyThreads{0};
+    // jobs that were cancelled before a worker got to them
+    std::atomic<uint64_t> droppedJobs{0};
 private:
     void threadLoop(const std::stop_token& st);
 };
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "glad/glad.h"
+
+// GL_UNIFORM_BUFFER backing std140 uniform blocks, the contents are bound to a binding point
+// that the shaders' blocks were pointed at with Shader::bindUniformBlock
+class UniformBuffer
+{
+public:
+    explicit UniformBuffer(GLsizeiptr size);
+    ~UniformBuffer();
+
+    UniformBuffer(const UniformBuffer& other) = delete;
+    UniformBuffer& operator=(const UniformBuffer& other) = delete;
+
+    // grows the storage to at least size bytes, the old contents are dropped
+    void reserve(GLsizeiptr size);
+    // grows the buffer if needed and orphans the old storage, so the driver doesn't wait for draws still reading it
+    void upload(const void* data, GLsizeiptr size);
+    void update(const void* data, GLsizeiptr size, GLintptr offset = 0) const;
+    void bindBase(GLuint bindingPoint) const;
+    // offset has to be a multiple of GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+    void bindRange(GLuint bindingPoint, GLintptr offset, GLsizeiptr size) const;
+    GLsizeiptr size() const { return m_Size; }
+private:
+    GLuint m_ID = 0;
+    GLsizeiptr m_Size;
+};
@@ -25,9 +25,10 @@ struct VertexBufferLayout
     GLsizei stride = 0;
 };
 
+// the vertex array object is created by the first addBuffer, so owners can be built without a GL context
 struct VertexArray
 {
-    VertexArray();
+    VertexArray() = default;
     ~VertexArray();
 
     VertexArray(const VertexArray& other) = delete;
@@ -37,6 +38,8 @@ struct VertexArray
     VertexArray& operator=(VertexArray&& other) noexcept;
 
     void addBuffer(GLuint bufferId, const VertexBufferLayout& layout);
+    // swaps the buffers for one created elsewhere (e.g. another context), keeps the vertex array
+    void replaceBuffers(GLuint bufferId, const VertexBufferLayout& layout);
     void bind() const;
     void unbind() const;
     void reset();
@@ -2,6 +2,7 @@
 
 #include "glad/glad.h"
 #include <GLFW/glfw3.h>
+#include "SharedContext.h"
 #include "glm/vec4.hpp"
 #include "glm/vec2.hpp"
 
@@ -32,6 +33,8 @@ public:
     glm::dvec2 getMousePosition() const;
     bool isKeyDown(int key) const;
     bool isMouseButtonDown(int button) const;
+    // hidden window whose context shares objects with this one, for use on another thread. Empty on failure.
+    SharedContext createSharedContext() const;
 
     const WindowSettings& getSettings() { return m_Settings; }
     GLFWwindow* getHandle() const { return m_Handle; }
@@ -2,10 +2,8 @@
 #include <fstream>
 #include <sstream>
 #include "OpenGLHelper.h"
-#include <GLFW/glfw3.h>
 #include <glm/gtc/type_ptr.hpp>
 
-int getUniformLocation(const GLuint shaderId, const std::string& name);
 static GLuint compile(const char* shaderSource, GLenum shaderType);
 static std::string parse(const char* shaderSource);
 
@@ -36,6 +34,8 @@ Shader::Shader(const char* pVertexShaderSource, const char* pFragmentShaderSourc
     GLCall(glDeleteShader(fragShaderID))
     if (pGeometryShaderSource != nullptr)
         GLCall(glDeleteShader(geoShaderID))
+
+    resolveUniforms();
 }
 
 Shader::~Shader()
@@ -43,47 +43,113 @@ Shader::~Shader()
     GLCall(glDeleteProgram(m_ID));
 }
 
+void Shader::resolveUniforms()
+{
+    GLint count = 0, maxLength = 0;
+    GLCall(glGetProgramiv(m_ID, GL_ACTIVE_UNIFORMS, &count))
+    GLCall(glGetProgramiv(m_ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength))
+
+    std::string name(maxLength, '\0');
+    for (GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        GLCall(glGetActiveUniform(m_ID, GLuint(i), maxLength, &length, &size, &type, name.data()))
+
+        // members of uniform blocks have no location, they are set through the block's buffer
+        const GLint location = glGetUniformLocation(m_ID, name.c_str());
+        if (location == -1)
+            continue;
+
+        // arrays are reported as "name[0]", they are looked up by their plain name
+        std::string uniformName = name.substr(0, length);
+        if (uniformName.ends_with("[0]"))
+            uniformName.resize(uniformName.size() - 3);
+        m_UniformLocations[uniformName] = location;
+    }
+}
+
+GLint Shader::getUniform(const std::string& name) const
+{
+    const auto it = m_UniformLocations.find(name);
+    if (it != m_UniformLocations.end())
+        return it->second;
+
+    LOG_WARN("Uniform not found: {}", name);
+    return -1;
+}
+
+void Shader::bindUniformBlock(const char* blockName, const GLuint bindingPoint) const
+{
+    const GLuint index = glGetUniformBlockIndex(m_ID, blockName);
+    if (index == GL_INVALID_INDEX)
+    {
+        LOG_WARN("Uniform block not found: {}", blockName);
+        return;
+    }
+
+    GLCall(glUniformBlockBinding(m_ID, index, bindingPoint))
+}
+
+void Shader::setUniform1f(const GLint location, const float value)
+{
+    GLCall(glUniform1f(location, value))
+}
+
+void Shader::setUniformMat4(const GLint location, const glm::mat4& mat)
+{
+    GLCall(glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat)));
+}
+
+void Shader::setUniform3f(const GLint location, const glm::vec3& vec)
+{
+    GLCall(glUniform3f(location, vec.x, vec.y, vec.z));
+}
+
+void Shader::setUniform1i(const GLint location, const int value)
+{
+    GLCall(glUniform1i(location, value))
+}
+
+void Shader::setUniform1u(const GLint location, const unsigned int value)
+{
+    GLCall(glUniform1ui(location, value))
+}
+
+void Shader::setUniform2u(const GLint location, const unsigned int x, const unsigned int y)
+{
+    GLCall(glUniform2ui(location, x, y))
+}
+
 void Shader::setUniform1f(const std::string &name, const float value)
 {
-    GLCall(glUniform1f(getUniformLocation(name), value))
+    setUniform1f(getUniform(name), value);
 }
 
 void Shader::setUniformMat4(const std::string& name, const glm::mat4& mat)
 {
-    GLCall(glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, glm::value_ptr(mat)));
+    setUniformMat4(getUniform(name), mat);
 }
 
 void Shader::setUniform3f(const std::string& name, const glm::vec3& vec)
 {
-    GLCall(glUniform3f(getUniformLocation(name), vec.x, vec.y, vec.z));
+    setUniform3f(getUniform(name), vec);
 }
 
 void Shader::setUniform1i(const std::string &name, const int value)
 {
-    GLCall(glUniform1i(getUniformLocation(name), value))
+    setUniform1i(getUniform(name), value);
 }
 
 void Shader::setUniform1u(const std::string &name, const unsigned int value)
 {
-    GLCall(glUniform1ui(getUniformLocation(name), value))
+    setUniform1u(getUniform(name), value);
 }
 
 void Shader::setUniform2u(const std::string &name, const unsigned int x,const unsigned int y)
 {
-    GLCall(glUniform2ui(getUniformLocation(name), x, y))
-}
-
-GLint Shader::getUniformLocation(const std::string &name)
-{
-    if (m_UniformLocations.contains(name))
-        return m_UniformLocations[name];
-
-    const GLint location = glGetUniformLocation(m_ID, name.c_str());
-    if (location == -1)
-        LOG_WARN("Uniform not found: {}", name);
-    m_UniformLocations[name] = location;
-
-    return location;
+    setUniform2u(getUniform(name), x, y);
 }
 
 void Shader::bind() const
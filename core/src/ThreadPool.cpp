@@ -13,11 +13,11 @@ ThreadPool::~ThreadPool()
     stop();
 }
 
-void ThreadPool::queueJob(const std::function<void()>& job)
+void ThreadPool::queueJob(const std::function<void()>& job, const float priority, CancellationToken token)
 {
     {
         std::lock_guard<std::mutex> lock(queueMutex);
-        jobs.push(job);
+        jobs.push({job, priority, jobsQueued++, std::move(token)});
     }
     mutexCondition.notify_one();
 }
@@ -39,7 +39,7 @@ void ThreadPool::threadLoop(const std::stop_token& st)
 {
     while (!st.stop_requested())
     {
-        std::function<void()> job;
+        Job job;
 
         {
             std::unique_lock<std::mutex> lock(queueMutex);
@@ -50,12 +50,18 @@ void ThreadPool::threadLoop(const std::stop_token& st)
             if (st.stop_requested())
                 return;
 
-            job = jobs.front();
+            job = jobs.top();
             jobs.pop();
+
+            if (job.token && job.token->load(std::memory_order_relaxed))
+            {
+                ++droppedJobs;
+                continue;
+            }
             ++busyThreads;
         }
 
-        job();
+        job.func();
         --busyThreads;
     }
 }
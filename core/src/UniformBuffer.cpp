@@ -0,0 +1,50 @@
+#include "UniformBuffer.h"
+#include <algorithm>
+#include "OpenGLHelper.h"
+
+UniformBuffer::UniformBuffer(const GLsizeiptr size)
+    : m_Size(size)
+{
+    GLCall(glGenBuffers(1, &m_ID))
+    GLCall(glBindBuffer(GL_UNIFORM_BUFFER, m_ID))
+    GLCall(glBufferData(GL_UNIFORM_BUFFER, m_Size, nullptr, GL_DYNAMIC_DRAW))
+}
+
+UniformBuffer::~UniformBuffer()
+{
+    GLCall(glDeleteBuffers(1, &m_ID))
+}
+
+void UniformBuffer::reserve(const GLsizeiptr size)
+{
+    if (size <= m_Size)
+        return;
+
+    m_Size = size;
+    GLCall(glBindBuffer(GL_UNIFORM_BUFFER, m_ID))
+    GLCall(glBufferData(GL_UNIFORM_BUFFER, m_Size, nullptr, GL_DYNAMIC_DRAW))
+}
+
+void UniformBuffer::upload(const void* data, const GLsizeiptr size)
+{
+    m_Size = std::max(m_Size, size);
+    GLCall(glBindBuffer(GL_UNIFORM_BUFFER, m_ID))
+    GLCall(glBufferData(GL_UNIFORM_BUFFER, m_Size, nullptr, GL_DYNAMIC_DRAW))
+    GLCall(glBufferSubData(GL_UNIFORM_BUFFER, 0, size, data))
+}
+
+void UniformBuffer::update(const void* data, const GLsizeiptr size, const GLintptr offset) const
+{
+    GLCall(glBindBuffer(GL_UNIFORM_BUFFER, m_ID))
+    GLCall(glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data))
+}
+
+void UniformBuffer::bindBase(const GLuint bindingPoint) const
+{
+    GLCall(glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, m_ID))
+}
+
+void UniformBuffer::bindRange(const GLuint bindingPoint, const GLintptr offset, const GLsizeiptr size) const
+{
+    GLCall(glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, m_ID, offset, size))
+}
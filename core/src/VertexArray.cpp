@@ -45,11 +45,6 @@ void VertexBufferLayout::pushInt(const GLint count, const GLboolean normalized,
     stride += count * sizeof(GLint);
 }
 
-VertexArray::VertexArray()
-{
-    GLCall(glGenVertexArrays(1, &arrayID))
-}
-
 VertexArray::VertexArray(VertexArray&& other) noexcept
     : buffers(std::move(other.buffers)),
       arrayID(other.arrayID),
@@ -84,6 +79,9 @@ VertexArray& VertexArray::operator=(VertexArray&& other) noexcept
 
 void VertexArray::addBuffer(const GLuint bufferId, const VertexBufferLayout& layout)
 {
+    if (arrayID == 0)
+        GLCall(glGenVertexArrays(1, &arrayID))
+
     buffers.emplace_back(bufferId);
     GLCall(glBindBuffer(GL_ARRAY_BUFFER, bufferId))
     bind();
@@ -108,6 +106,16 @@ void VertexArray::addBuffer(const GLuint bufferId, const VertexBufferLayout& lay
     }
 }
 
+void VertexArray::replaceBuffers(const GLuint bufferId, const VertexBufferLayout& layout)
+{
+    for (const auto& buffer : buffers)
+        GLCall(glDeleteBuffers(1, &buffer))
+    buffers.clear();
+    attribCounter = 0;
+
+    addBuffer(bufferId, layout);
+}
+
 VertexArray::~VertexArray()
 {
     clear();
@@ -126,13 +134,13 @@ void VertexArray::unbind() const
 void VertexArray::reset()
 {
     clear();
-    GLCall(glGenVertexArrays(1, &arrayID))
 }
 
 void VertexArray::clear()
 {
     if (arrayID != 0)
         GLCall(glDeleteVertexArrays(1, &arrayID))
+    arrayID = 0;
 
     for (const auto& buffer : buffers)
         GLCall(glDeleteBuffers(1, &buffer))
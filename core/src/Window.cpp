@@ -48,6 +48,21 @@ void Window::destroy()
     }
 }
 
+SharedContext Window::createSharedContext() const
+{
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* context = glfwCreateWindow(1, 1, "", nullptr, m_Handle);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if (!context)
+        return {};
+
+    return {[context](const bool current) { glfwMakeContextCurrent(current ? context : nullptr); },
+            [context] { glfwDestroyWindow(context); }};
+}
+
 void Window::disableCursor(const bool disable) const
 {
     glfwSetInputMode(m_Handle, GLFW_CURSOR, disable ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);